@@ -0,0 +1,224 @@
+#include "raygizmo.h"
+
+#include "raylib.h"
+#include "raylib_headless.h"
+#include "raymath.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Micro-benchmarks of the CPU side of the gizmo, linked against the
+// headless raylib (the GPU picking measures only the work of submitting the
+// pass). Every benchmark is run for N_SAMPLES samples of at least
+// SAMPLE_TIME seconds, the min and the median time per call go to stdout,
+// one line per benchmark, so the outputs of two builds could be diffed:
+// ./raygizmo_bench [name_substring]
+
+#define SCREEN_WIDTH 800
+#define SCREEN_HEIGHT 450
+#define N_SAMPLES 9
+#define SAMPLE_TIME 0.02
+
+#define N_MOUSE_POSITIONS 64
+
+static Camera3D CAMERA;
+static Vector3 POSITION;
+static RGizmo GIZMO;
+static Vector2 MOUSE_POSITIONS[N_MOUSE_POSITIONS];
+
+static RGizmoDrawVertex DRAW_VERTICES[RGIZMO_DRAW_LIST_MAX_VERTICES];
+static unsigned short DRAW_INDICES[RGIZMO_DRAW_LIST_MAX_INDICES];
+static RGizmoDrawList DRAW_LIST = {
+    DRAW_VERTICES,
+    DRAW_INDICES,
+    RGIZMO_DRAW_LIST_MAX_VERTICES,
+    RGIZMO_DRAW_LIST_MAX_INDICES,
+    0,
+    0};
+
+// Results go here, so the calls can't be optimized out
+static volatile float SINK;
+
+static RGizmoInput get_input(int i) {
+    RGizmoInput input = {
+        MOUSE_POSITIONS[i % N_MOUSE_POSITIONS],
+        {3.0f, -2.0f},
+        false,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT};
+    return input;
+}
+
+// -----------------------------------------------------------------------
+// Benchmarks, each runs its call n times
+static void bench_pick_cpu(int n) {
+    GIZMO.picking.mode = RGIZMO_PICK_CPU;
+    for (int i = 0; i < n; ++i) {
+        rgizmo_invalidate_pick_cache(&GIZMO);
+        SINK += rgizmo_pick(&GIZMO, CAMERA, POSITION, get_input(i));
+    }
+}
+
+static void bench_pick_gpu_submit(int n) {
+    GIZMO.picking.mode = RGIZMO_PICK_GPU;
+    for (int i = 0; i < n; ++i) {
+        rgizmo_invalidate_pick_cache(&GIZMO);
+        SINK += rgizmo_pick(&GIZMO, CAMERA, POSITION, get_input(i));
+    }
+}
+
+static void bench_pick_draw_list(int n) {
+    for (int i = 0; i < n; ++i) {
+        SINK += rgizmo_pick_draw_list(&DRAW_LIST, CAMERA, get_input(i));
+    }
+}
+
+static void run_solve(int n, RGizmoState state) {
+    RGizmoSolveInput in;
+    memset(&in, 0, sizeof(in));
+    in.state = state;
+    in.axis = (Vector3){0.0f, 1.0f, 0.0f};
+    in.camera = CAMERA;
+    in.position = POSITION;
+
+    RGizmoSolveOutput out;
+    for (int i = 0; i < n; ++i) {
+        in.input = get_input(i);
+        in.input.is_lmb_down = true;
+        rgizmo_solve(&in, &out);
+        SINK += out.angle + out.translation.x;
+    }
+}
+
+static void bench_solve_rot(int n) {
+    run_solve(n, RGIZMO_STATE_ACTIVE_ROT);
+}
+
+static void bench_solve_axis(int n) {
+    run_solve(n, RGIZMO_STATE_ACTIVE_AXIS);
+}
+
+static void bench_solve_plane(int n) {
+    run_solve(n, RGIZMO_STATE_ACTIVE_PLANE);
+}
+
+static void bench_get_tranform(int n) {
+    RGizmo gizmo = GIZMO;
+    gizmo.update.axis = (Vector3){0.0f, 1.0f, 0.0f};
+    gizmo.update.translation = (Vector3){0.1f, 0.2f, 0.3f};
+    for (int i = 0; i < n; ++i) {
+        gizmo.update.angle = 0.001f * (i % 1000);
+        SINK += rgizmo_get_tranform(gizmo, POSITION).m12;
+    }
+}
+
+static void bench_build_draw_list(int n) {
+    for (int i = 0; i < n; ++i) {
+        DRAW_LIST.n_vertices = 0;
+        DRAW_LIST.n_indices = 0;
+        rgizmo_build_draw_list(
+            GIZMO, CAMERA, POSITION, get_input(i), &DRAW_LIST
+        );
+        SINK += DRAW_LIST.n_indices;
+    }
+}
+
+static void bench_update_cpu(int n) {
+    GIZMO.picking.mode = RGIZMO_PICK_CPU;
+    for (int i = 0; i < n; ++i) {
+        SINK += rgizmo_update_ex(&GIZMO, CAMERA, POSITION, get_input(i));
+    }
+}
+
+typedef struct Benchmark {
+    const char *name;
+    void (*run)(int n);
+} Benchmark;
+
+#define BENCHMARK(name) {#name, bench_##name}
+
+static const Benchmark BENCHMARKS[] = {
+    BENCHMARK(pick_cpu),
+    BENCHMARK(pick_gpu_submit),
+    BENCHMARK(pick_draw_list),
+    BENCHMARK(solve_rot),
+    BENCHMARK(solve_axis),
+    BENCHMARK(solve_plane),
+    BENCHMARK(get_tranform),
+    BENCHMARK(build_draw_list),
+    BENCHMARK(update_cpu),
+};
+
+// -----------------------------------------------------------------------
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Doubles the number of calls until one sample takes SAMPLE_TIME
+static int get_n_calls(const Benchmark *benchmark) {
+    int n = 1;
+    while (n < (1 << 30)) {
+        double start = GetTime();
+        benchmark->run(n);
+        if (GetTime() - start >= SAMPLE_TIME) break;
+        n *= 2;
+    }
+    return n;
+}
+
+static void run_benchmark(const Benchmark *benchmark) {
+    int n = get_n_calls(benchmark);
+
+    double samples[N_SAMPLES];
+    for (int i = 0; i < N_SAMPLES; ++i) {
+        double start = GetTime();
+        benchmark->run(n);
+        samples[i] = 1e9 * (GetTime() - start) / n;
+    }
+
+    qsort(samples, N_SAMPLES, sizeof(double), compare_doubles);
+    printf(
+        "%-18s %10d %12.1f %12.1f\n",
+        benchmark->name,
+        n,
+        samples[0],
+        samples[N_SAMPLES / 2]
+    );
+}
+
+int main(int argc, char **argv) {
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "raygizmo bench");
+
+    memset(&CAMERA, 0, sizeof(CAMERA));
+    CAMERA.fovy = 45.0f;
+    CAMERA.position = (Vector3){5.0f, 5.0f, 5.0f};
+    CAMERA.up = (Vector3){0.0f, 1.0f, 0.0f};
+    CAMERA.projection = CAMERA_PERSPECTIVE;
+    POSITION = Vector3Zero();
+    GIZMO = rgizmo_create();
+
+    // Cursor positions over and around the gizmo
+    Rectangle bounds = rgizmo_get_screen_bounds(GIZMO, CAMERA, POSITION);
+    srand(1);
+    for (int i = 0; i < N_MOUSE_POSITIONS; ++i) {
+        MOUSE_POSITIONS[i] = (Vector2){
+            bounds.x + bounds.width * (float)rand() / RAND_MAX,
+            bounds.y + bounds.height * (float)rand() / RAND_MAX};
+    }
+    rgizmo_build_draw_list(GIZMO, CAMERA, POSITION, get_input(0), &DRAW_LIST);
+
+    printf("%-18s %10s %12s %12s\n", "benchmark", "calls", "min_ns", "med_ns");
+    int n_benchmarks = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+    for (int i = 0; i < n_benchmarks; ++i) {
+        if (argc > 1 && !strstr(BENCHMARKS[i].name, argv[1])) continue;
+        run_benchmark(&BENCHMARKS[i]);
+    }
+
+    rgizmo_unload();
+    CloseWindow();
+
+    return 0;
+}
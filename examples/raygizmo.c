@@ -1,5 +1,7 @@
 #include "raylib.h"
 #include "rcamera.h"
+#include <stdio.h>
+#include <string.h>
 
 #define RAYGIZMO_IMPLEMENTATION
 #include "raygizmo.h"
@@ -35,7 +37,21 @@ static void update_camera(Camera3D *camera) {
     CameraMoveToTarget(camera, -GetMouseWheelMove() * CAMERA_ZOOM_SPEED);
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+    // Record the gizmo input into a trace file, which could be replayed with
+    // the replay example: ./raygizmo --record trace.bin
+    FILE *trace = NULL;
+    if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+        trace = fopen(argv[2], "wb");
+        if (!trace) {
+            fprintf(stderr, "Failed to open %s\n", argv[2]);
+            return 1;
+        }
+        unsigned char header[RGIZMO_TRACE_HEADER_SIZE];
+        rgizmo_trace_write_header(header);
+        fwrite(header, 1, sizeof(header), trace);
+    }
+
     InitWindow(800, 450, "raygizmo");
     SetTargetFPS(60);
 
@@ -57,7 +73,14 @@ int main(void) {
             Vector3 position = {
                 model.transform.m12, model.transform.m13, model.transform.m14};
 
-            rgizmo_update(&gizmo, camera, position);
+            RGizmoInput input = rgizmo_get_input();
+            rgizmo_update_ex(&gizmo, camera, position, input);
+            if (trace) {
+                unsigned char record[RGIZMO_TRACE_FRAME_SIZE];
+                RGizmoTraceFrame frame = {input, camera, position};
+                rgizmo_trace_write_frame(record, frame);
+                fwrite(record, 1, sizeof(record), trace);
+            }
             model.transform = MatrixMultiply(
                 model.transform, rgizmo_get_tranform(gizmo, position)
             );
@@ -105,6 +128,7 @@ int main(void) {
     rgizmo_unload();
     UnloadModel(model);
     CloseWindow();
+    if (trace) fclose(trace);
 
     return 0;
 }
@@ -0,0 +1,104 @@
+#include "raylib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAYGIZMO_IMPLEMENTATION
+#include "raygizmo.h"
+
+// Replays a trace recorded with `./raygizmo --record trace.bin` through
+// rgizmo_update_ex. The gizmo state and transform of every frame go to
+// stdout (so the runs of two builds could be diffed), the update latency
+// percentiles go to stderr:
+// ./replay trace.bin [gpu|cpu|gpu_async] > transforms.txt
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double get_percentile(const double *sorted, int count, double p) {
+    int idx = (int)(p * (count - 1) + 0.5);
+    return sorted[idx];
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [gpu|cpu|gpu_async]\n", argv[0]);
+        return 1;
+    }
+
+    RGizmoPickMode mode = RGIZMO_PICK_GPU;
+    if (argc > 2 && strcmp(argv[2], "cpu") == 0) mode = RGIZMO_PICK_CPU;
+    if (argc > 2 && strcmp(argv[2], "gpu_async") == 0) {
+        mode = RGIZMO_PICK_GPU_ASYNC;
+    }
+
+    int size = 0;
+    unsigned char *data = LoadFileData(argv[1], &size);
+    if (!data || !rgizmo_trace_read_header(data, size)) {
+        fprintf(stderr, "Invalid trace: %s\n", argv[1]);
+        return 1;
+    }
+    int n_frames = (size - RGIZMO_TRACE_HEADER_SIZE) / RGIZMO_TRACE_FRAME_SIZE;
+    if (n_frames == 0) {
+        fprintf(stderr, "Empty trace: %s\n", argv[1]);
+        return 1;
+    }
+
+    // GPU picking needs a GL context of the recorded screen size, the window
+    // itself is never shown
+    const unsigned char *frames = data + RGIZMO_TRACE_HEADER_SIZE;
+    RGizmoTraceFrame first = rgizmo_trace_read_frame(frames);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(
+        first.input.screen_width, first.input.screen_height, "raygizmo replay"
+    );
+
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = mode;
+
+    double *latencies = (double *)malloc(n_frames * sizeof(double));
+    for (int i = 0; i < n_frames; ++i) {
+        RGizmoTraceFrame frame = rgizmo_trace_read_frame(
+            frames + i * RGIZMO_TRACE_FRAME_SIZE
+        );
+
+        double start = GetTime();
+        rgizmo_update_ex(&gizmo, frame.camera, frame.position, frame.input);
+        latencies[i] = GetTime() - start;
+
+        printf(
+            "%d %d %f %f %f %f %f %f %f\n",
+            i,
+            gizmo.state,
+            gizmo.update.translation.x,
+            gizmo.update.translation.y,
+            gizmo.update.translation.z,
+            gizmo.update.axis.x,
+            gizmo.update.axis.y,
+            gizmo.update.axis.z,
+            gizmo.update.angle
+        );
+    }
+
+    qsort(latencies, n_frames, sizeof(double), compare_doubles);
+    fprintf(
+        stderr,
+        "frames: %d\nlatency (us): p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n",
+        n_frames,
+        1e6 * get_percentile(latencies, n_frames, 0.5),
+        1e6 * get_percentile(latencies, n_frames, 0.9),
+        1e6 * get_percentile(latencies, n_frames, 0.99),
+        1e6 * latencies[n_frames - 1]
+    );
+
+    free(latencies);
+    UnloadFileData(data);
+    rgizmo_unload();
+    CloseWindow();
+
+    return 0;
+}
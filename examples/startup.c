@@ -0,0 +1,86 @@
+#include "raylib.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RAYGIZMO_IMPLEMENTATION
+#include "raygizmo.h"
+
+// Measures what the gizmo costs at startup: the window creation for the
+// reference, rgizmo_create and the first draw and GPU picking pass, which
+// create the GPU resources, against the later ones. Times go to stderr:
+// ./startup [program_cache.bin]
+// With RAYGIZMO_DIRECT_GL the second run loads the program from the cache
+
+static double get_ms(double start) {
+    return 1e3 * (GetTime() - start);
+}
+
+// Draws one frame with the gizmo and returns the time of its calls
+static double draw_frame(RGizmo gizmo, Camera3D camera, Vector3 position) {
+    BeginDrawing();
+    ClearBackground(BLACK);
+    double start = GetTime();
+    rgizmo_draw(gizmo, camera, position);
+    double time = get_ms(start);
+    EndDrawing();
+    return time;
+}
+
+int main(int argc, char **argv) {
+    double start = GetTime();
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(800, 600, "raygizmo startup");
+    double window_ms = get_ms(start);
+
+    if (argc > 1) rgizmo_set_program_cache(argv[1]);
+
+    Camera3D camera;
+    memset(&camera, 0, sizeof(camera));
+    camera.fovy = 45.0f;
+    camera.position = (Vector3){5.0f, 5.0f, 5.0f};
+    camera.up = (Vector3){0.0f, 1.0f, 0.0f};
+    camera.projection = CAMERA_PERSPECTIVE;
+    Vector3 position = {0.0f, 0.0f, 0.0f};
+
+    // The cursor over the gizmo center, so the update picks on the GPU
+    RGizmoInput input = {{400.0f, 300.0f}, {0.0f, 0.0f}, false, 800, 600};
+
+    start = GetTime();
+    RGizmo gizmo = rgizmo_create();
+    double create_ms = get_ms(start);
+
+    double first_draw_ms = draw_frame(gizmo, camera, position);
+    double next_draw_ms = draw_frame(gizmo, camera, position);
+
+    start = GetTime();
+    rgizmo_update_ex(&gizmo, camera, position, input);
+    double first_pick_ms = get_ms(start);
+
+    input.mouse_position.x += 1.0f;
+    start = GetTime();
+    rgizmo_update_ex(&gizmo, camera, position, input);
+    double next_pick_ms = get_ms(start);
+
+    RGizmoError error = rgizmo_get_error();
+    fprintf(
+        stderr,
+        "window: %.2f ms\n"
+        "rgizmo_create: %.3f ms\n"
+        "draw: first %.2f ms, next %.2f ms\n"
+        "pick: first %.2f ms, next %.2f ms\n"
+        "error: %d\n",
+        window_ms,
+        create_ms,
+        first_draw_ms,
+        next_draw_ms,
+        first_pick_ms,
+        next_pick_ms,
+        error
+    );
+
+    rgizmo_unload();
+    CloseWindow();
+
+    return error == RGIZMO_ERROR_NONE ? 0 : 1;
+}
@@ -0,0 +1,706 @@
+// clock_gettime
+#define _POSIX_C_SOURCE 199309L
+
+#include "raylib_headless.h"
+
+#include "raylib.h"
+#define RAYMATH_IMPLEMENTATION
+#include "raymath.h"
+#include "rlgl.h"
+#if defined(RAYLIB_HEADLESS_GL)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int SCREEN_WIDTH = 800;
+static int SCREEN_HEIGHT = 450;
+static Vector2 MOUSE_POSITION;
+static Vector2 MOUSE_DELTA;
+static bool IS_LMB_DOWN;
+static int TRACE_LOG_LEVEL = LOG_INFO;
+static int N_WARNINGS;
+static double TIME_OFFSET;
+
+static unsigned int N_DRAW_CALLS;
+static unsigned int LAST_ID;
+static bool IS_GPU_BUSY;
+static int N_FENCES;
+static int RLGL_VERSION = RL_OPENGL_33;
+static bool IS_FRAMEBUFFER_FAILING;
+static int VIEWPORT[4] = {0, 0, 800, 450};
+
+// Like rlgl, the lines take the line width which is set when their batch is
+// drawn, not the one set when they were added
+#define MAX_LINES 64
+static float LINE_WIDTH = 1.0f;
+static int N_BATCH_LINES;
+static float LINE_WIDTHS[MAX_LINES];
+static int N_LINES;
+
+static void draw_batch(void) {
+    for (int i = 0; i < N_BATCH_LINES && N_LINES < MAX_LINES; ++i) {
+        LINE_WIDTHS[N_LINES++] = LINE_WIDTH;
+    }
+    N_BATCH_LINES = 0;
+}
+
+// The rlgl matrices, which BeginMode3D sets like raylib does
+#define IDENTITY \
+    {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, \
+     0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f}
+static Matrix MATRIX_PROJECTION = IDENTITY;
+static Matrix MATRIX_MODELVIEW = IDENTITY;
+static Matrix PREV_MATRIX_PROJECTION = IDENTITY;
+static Matrix UNIFORM_MATRIX = IDENTITY;
+
+void headless_set_screen_size(int width, int height) {
+    SCREEN_WIDTH = width;
+    SCREEN_HEIGHT = height;
+}
+
+void headless_set_mouse(Vector2 position, Vector2 delta, bool is_lmb_down) {
+    MOUSE_POSITION = position;
+    MOUSE_DELTA = delta;
+    IS_LMB_DOWN = is_lmb_down;
+}
+
+unsigned int headless_get_n_draw_calls(void) {
+    return N_DRAW_CALLS;
+}
+
+void headless_set_time_offset(double offset) {
+    TIME_OFFSET = offset;
+}
+
+int headless_get_n_warnings(void) {
+    return N_WARNINGS;
+}
+
+void headless_reset_n_draw_calls(void) {
+    N_DRAW_CALLS = 0;
+    N_LINES = 0;
+}
+
+int headless_get_line_widths(float *widths, int max_count) {
+    int count = N_LINES < max_count ? N_LINES : max_count;
+    memcpy(widths, LINE_WIDTHS, count * sizeof(float));
+    return count;
+}
+
+Matrix headless_get_uniform_matrix(void) {
+    return UNIFORM_MATRIX;
+}
+
+void headless_get_viewport(int viewport[4]) {
+    memcpy(viewport, VIEWPORT, sizeof(VIEWPORT));
+}
+
+void headless_set_framebuffer_failing(bool is_failing) {
+    IS_FRAMEBUFFER_FAILING = is_failing;
+}
+
+void headless_set_gl_version(int version) {
+    RLGL_VERSION = version;
+}
+
+void headless_set_gpu_busy(bool is_busy) {
+    IS_GPU_BUSY = is_busy;
+}
+
+int headless_get_n_fences(void) {
+    return N_FENCES;
+}
+
+// Ids of the GL objects, 1 is the default shader
+static unsigned int load_id(void) {
+    if (LAST_ID == 0) LAST_ID = 1;
+    return ++LAST_ID;
+}
+
+// -----------------------------------------------------------------------
+// Window, input and time
+void InitWindow(int width, int height, const char *title) {
+    headless_set_screen_size(width, height);
+}
+
+void CloseWindow(void) {}
+
+bool WindowShouldClose(void) {
+    return true;
+}
+
+void SetConfigFlags(unsigned int flags) {}
+
+void SetTraceLogLevel(int logLevel) {
+    TRACE_LOG_LEVEL = logLevel;
+}
+
+int GetScreenWidth(void) {
+    return SCREEN_WIDTH;
+}
+
+int GetScreenHeight(void) {
+    return SCREEN_HEIGHT;
+}
+
+Vector2 GetMousePosition(void) {
+    return MOUSE_POSITION;
+}
+
+Vector2 GetMouseDelta(void) {
+    return MOUSE_DELTA;
+}
+
+bool IsMouseButtonDown(int button) {
+    return button == MOUSE_BUTTON_LEFT && IS_LMB_DOWN;
+}
+
+double GetTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return TIME_OFFSET + (double)time.tv_sec + 1e-9 * (double)time.tv_nsec;
+}
+
+void TraceLog(int logLevel, const char *text, ...) {
+    if (logLevel == LOG_WARNING) N_WARNINGS += 1;
+    if (logLevel < TRACE_LOG_LEVEL) return;
+
+    va_list args;
+    va_start(args, text);
+    vfprintf(stderr, text, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// -----------------------------------------------------------------------
+// Files
+unsigned char *LoadFileData(const char *fileName, int *dataSize) {
+    *dataSize = 0;
+    FILE *file = fopen(fileName, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(size > 0 ? size : 1);
+    if (data && fread(data, 1, size, file) == (size_t)size) {
+        *dataSize = (int)size;
+    } else {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+void UnloadFileData(unsigned char *data) {
+    free(data);
+}
+
+bool SaveFileData(const char *fileName, void *data, int dataSize) {
+    FILE *file = fopen(fileName, "wb");
+    if (!file) return false;
+
+    bool is_written = fwrite(data, 1, dataSize, file) == (size_t)dataSize;
+    fclose(file);
+    return is_written;
+}
+
+bool SaveFileText(const char *fileName, char *text) {
+    return SaveFileData(fileName, text, (int)strlen(text));
+}
+
+bool FileExists(const char *fileName) {
+    FILE *file = fopen(fileName, "rb");
+    if (!file) return false;
+
+    fclose(file);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+// Camera math, the same as raylib's
+static Matrix get_projection(Camera camera, int width, int height) {
+    double aspect = (double)width / (double)height;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        return MatrixPerspective(
+            camera.fovy * DEG2RAD,
+            aspect,
+            RL_CULL_DISTANCE_NEAR,
+            RL_CULL_DISTANCE_FAR
+        );
+    }
+
+    double top = camera.fovy / 2.0;
+    double right = top * aspect;
+    return MatrixOrtho(
+        -right, right, -top, top, RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR
+    );
+}
+
+Vector2 GetWorldToScreenEx(
+    Vector3 position, Camera camera, int width, int height
+) {
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = get_projection(camera, width, height);
+    Quaternion p = {position.x, position.y, position.z, 1.0f};
+    p = QuaternionTransform(QuaternionTransform(p, view), projection);
+
+    Vector2 ndc = {p.x / p.w, -p.y / p.w};
+    return (Vector2){
+        (ndc.x + 1.0f) / 2.0f * (float)width,
+        (ndc.y + 1.0f) / 2.0f * (float)height};
+}
+
+Vector2 GetWorldToScreen(Vector3 position, Camera camera) {
+    return GetWorldToScreenEx(position, camera, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+Ray GetMouseRay(Vector2 mousePosition, Camera camera) {
+    float x = 2.0f * mousePosition.x / (float)SCREEN_WIDTH - 1.0f;
+    float y = 1.0f - 2.0f * mousePosition.y / (float)SCREEN_HEIGHT;
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = get_projection(camera, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    Vector3 near_point = Vector3Unproject(
+        (Vector3){x, y, 0.0f}, projection, view
+    );
+    Vector3 far_point = Vector3Unproject(
+        (Vector3){x, y, 1.0f}, projection, view
+    );
+    Vector3 origin = Vector3Unproject(
+        (Vector3){x, y, -1.0f}, projection, view
+    );
+
+    Ray ray;
+    ray.position = camera.projection == CAMERA_PERSPECTIVE ? camera.position
+                                                           : origin;
+    ray.direction = Vector3Normalize(Vector3Subtract(far_point, near_point));
+    return ray;
+}
+
+// -----------------------------------------------------------------------
+// Shapes and colors
+bool CheckCollisionPointRec(Vector2 point, Rectangle rec) {
+    return point.x >= rec.x && point.x < rec.x + rec.width && point.y >= rec.y
+           && point.y < rec.y + rec.height;
+}
+
+bool CheckCollisionPointTriangle(
+    Vector2 point, Vector2 p1, Vector2 p2, Vector2 p3
+) {
+    float d = (p2.y - p3.y) * (p1.x - p3.x) + (p3.x - p2.x) * (p1.y - p3.y);
+    float alpha = ((p2.y - p3.y) * (point.x - p3.x)
+                   + (p3.x - p2.x) * (point.y - p3.y))
+                  / d;
+    float beta = ((p3.y - p1.y) * (point.x - p3.x)
+                  + (p1.x - p3.x) * (point.y - p3.y))
+                 / d;
+    float gamma = 1.0f - alpha - beta;
+    return alpha > 0.0f && beta > 0.0f && gamma > 0.0f;
+}
+
+Rectangle GetCollisionRec(Rectangle rec1, Rectangle rec2) {
+    float left = fmaxf(rec1.x, rec2.x);
+    float right = fminf(rec1.x + rec1.width, rec2.x + rec2.width);
+    float top = fmaxf(rec1.y, rec2.y);
+    float bottom = fminf(rec1.y + rec1.height, rec2.y + rec2.height);
+
+    Rectangle overlap = {0};
+    if (left < right && top < bottom) {
+        overlap = (Rectangle){left, top, right - left, bottom - top};
+    }
+    return overlap;
+}
+
+Vector4 ColorNormalize(Color color) {
+    return (Vector4){
+        color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
+}
+
+int ColorToInt(Color color) {
+    return (int)(((unsigned int)color.r << 24) | ((unsigned int)color.g << 16)
+                 | ((unsigned int)color.b << 8) | (unsigned int)color.a);
+}
+
+// -----------------------------------------------------------------------
+// Drawing
+void BeginDrawing(void) {}
+
+void EndDrawing(void) {}
+
+void ClearBackground(Color color) {}
+
+void BeginMode3D(Camera3D camera) {
+    draw_batch();
+    PREV_MATRIX_PROJECTION = MATRIX_PROJECTION;
+
+    // Like raylib, the frustum of the current framebuffer size
+    double aspect = (double)SCREEN_WIDTH / (double)SCREEN_HEIGHT;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        double top = RL_CULL_DISTANCE_NEAR * tan(camera.fovy * 0.5 * DEG2RAD);
+        double right = top * aspect;
+        MATRIX_PROJECTION = MatrixFrustum(
+            -right,
+            right,
+            -top,
+            top,
+            RL_CULL_DISTANCE_NEAR,
+            RL_CULL_DISTANCE_FAR
+        );
+    } else {
+        MATRIX_PROJECTION = get_projection(
+            camera, SCREEN_WIDTH, SCREEN_HEIGHT
+        );
+    }
+    MATRIX_MODELVIEW = MatrixLookAt(camera.position, camera.target, camera.up);
+}
+
+void EndMode3D(void) {
+    draw_batch();
+    MATRIX_PROJECTION = PREV_MATRIX_PROJECTION;
+    MATRIX_MODELVIEW = MatrixIdentity();
+}
+
+void BeginShaderMode(Shader shader) {}
+
+void EndShaderMode(void) {}
+
+void DrawLine3D(Vector3 startPos, Vector3 endPos, Color color) {
+    N_DRAW_CALLS += 1;
+    N_BATCH_LINES += 1;
+}
+
+void DrawLineV(Vector2 startPos, Vector2 endPos, Color color) {
+    N_DRAW_CALLS += 1;
+    N_BATCH_LINES += 1;
+}
+
+// -----------------------------------------------------------------------
+// Shaders
+Shader LoadShaderFromMemory(const char *vsCode, const char *fsCode) {
+    Shader shader = {0};
+    shader.id = load_id();
+    return shader;
+}
+
+bool IsShaderReady(Shader shader) {
+    return shader.id != 0;
+}
+
+int GetShaderLocation(Shader shader, const char *uniformName) {
+    return rlGetLocationUniform(shader.id, uniformName);
+}
+
+void UnloadShader(Shader shader) {}
+
+// -----------------------------------------------------------------------
+// rlgl
+void rlViewport(int x, int y, int width, int height) {
+    VIEWPORT[0] = x;
+    VIEWPORT[1] = y;
+    VIEWPORT[2] = width;
+    VIEWPORT[3] = height;
+}
+
+void rlActiveDrawBuffers(int count) {}
+
+void rlClearColor(
+    unsigned char r, unsigned char g, unsigned char b, unsigned char a
+) {}
+
+void rlClearScreenBuffers(void) {}
+
+void rlEnableColorBlend(void) {}
+
+void rlDisableColorBlend(void) {}
+
+void rlEnableDepthTest(void) {}
+
+void rlDisableDepthTest(void) {}
+
+void rlEnableBackfaceCulling(void) {}
+
+void rlDisableBackfaceCulling(void) {}
+
+void rlSetLineWidth(float width) {
+    LINE_WIDTH = width;
+}
+
+float rlGetLineWidth(void) {
+    return LINE_WIDTH;
+}
+
+void rlDrawRenderBatchActive(void) {
+    draw_batch();
+}
+
+Matrix rlGetMatrixModelview(void) {
+    return MATRIX_MODELVIEW;
+}
+
+Matrix rlGetMatrixProjection(void) {
+    return MATRIX_PROJECTION;
+}
+
+void rlSetMatrixProjection(Matrix proj) {
+    MATRIX_PROJECTION = proj;
+}
+
+void rlSetMatrixModelview(Matrix view) {
+    MATRIX_MODELVIEW = view;
+}
+
+int rlGetFramebufferWidth(void) {
+    return SCREEN_WIDTH;
+}
+
+int rlGetFramebufferHeight(void) {
+    return SCREEN_HEIGHT;
+}
+
+unsigned int rlLoadVertexArray(void) {
+    return load_id();
+}
+
+unsigned int rlLoadVertexBuffer(const void *buffer, int size, bool dynamic) {
+    return load_id();
+}
+
+void rlUpdateVertexBuffer(
+    unsigned int bufferId, const void *data, int dataSize, int offset
+) {}
+
+void rlUnloadVertexArray(unsigned int vaoId) {}
+
+void rlUnloadVertexBuffer(unsigned int vboId) {}
+
+bool rlEnableVertexArray(unsigned int vaoId) {
+    return true;
+}
+
+void rlDisableVertexArray(void) {}
+
+void rlEnableVertexBuffer(unsigned int id) {}
+
+void rlDisableVertexBuffer(void) {}
+
+void rlEnableVertexAttribute(unsigned int index) {}
+
+void rlDisableVertexAttribute(unsigned int index) {}
+
+void rlSetVertexAttribute(
+    unsigned int index,
+    int compSize,
+    int type,
+    bool normalized,
+    int stride,
+    const void *pointer
+) {}
+
+void rlSetVertexAttributeDivisor(unsigned int index, int divisor) {}
+
+void rlSetVertexAttributeDefault(
+    int locIndex, const void *value, int attribType, int count
+) {}
+
+int rlGetVersion(void) {
+    return RLGL_VERSION;
+}
+
+void rlDrawVertexArray(int offset, int count) {
+    N_DRAW_CALLS += 1;
+}
+
+void rlDrawVertexArrayInstanced(int offset, int count, int instances) {
+    N_DRAW_CALLS += 1;
+}
+
+unsigned int rlLoadTexture(
+    const void *data, int width, int height, int format, int mipmapCount
+) {
+    return load_id();
+}
+
+unsigned int rlLoadTextureDepth(int width, int height, bool useRenderBuffer) {
+    return load_id();
+}
+
+void rlUnloadTexture(unsigned int id) {}
+
+// Nothing is ever rendered, so the picking passes read back empty pixels
+void *rlReadTexturePixels(
+    unsigned int id, int width, int height, int format
+) {
+    return calloc((size_t)width * height, 4);
+}
+
+unsigned int rlLoadFramebuffer(int width, int height) {
+    return load_id();
+}
+
+void rlFramebufferAttach(
+    unsigned int fboId,
+    unsigned int texId,
+    int attachType,
+    int texType,
+    int mipLevel
+) {}
+
+bool rlFramebufferComplete(unsigned int id) {
+    return !IS_FRAMEBUFFER_FAILING;
+}
+
+void rlUnloadFramebuffer(unsigned int id) {}
+
+void rlEnableFramebuffer(unsigned int id) {}
+
+void rlDisableFramebuffer(void) {}
+
+unsigned int rlLoadShaderCode(const char *vsCode, const char *fsCode) {
+    return load_id();
+}
+
+void rlUnloadShaderProgram(unsigned int id) {}
+
+unsigned int rlGetShaderIdDefault(void) {
+    return 1;
+}
+
+void rlEnableShader(unsigned int id) {}
+
+void rlDisableShader(void) {}
+
+int rlGetLocationUniform(unsigned int shaderId, const char *uniformName) {
+    return 0;
+}
+
+int rlGetLocationAttrib(unsigned int shaderId, const char *attribName) {
+    return 0;
+}
+
+void rlSetUniform(
+    int locIndex, const void *value, int uniformType, int count
+) {}
+
+void rlSetUniformMatrix(int locIndex, Matrix mat) {
+    UNIFORM_MATRIX = mat;
+}
+
+// -----------------------------------------------------------------------
+// OpenGL, the calls of RAYGIZMO_DIRECT_GL. The shaders always compile, the
+// pixel buffers read back empty pixels and the fences are signaled unless
+// the GPU is set busy
+#if defined(RAYLIB_HEADLESS_GL)
+static unsigned char PIXEL_BUFFER[4096];
+
+void glGetIntegerv(GLenum pname, GLint *data) {
+    if (pname == GL_VIEWPORT) memcpy(data, VIEWPORT, sizeof(VIEWPORT));
+    else *data = 0;
+}
+
+const GLubyte *glGetString(GLenum name) {
+    return (const GLubyte *)"headless";
+}
+
+void glReadPixels(
+    GLint x,
+    GLint y,
+    GLsizei width,
+    GLsizei height,
+    GLenum format,
+    GLenum type,
+    void *pixels
+) {}
+
+GLuint glCreateShader(GLenum type) {
+    return load_id();
+}
+
+void glShaderSource(
+    GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length
+) {}
+
+void glCompileShader(GLuint shader) {}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void glDeleteShader(GLuint shader) {}
+
+GLuint glCreateProgram(void) {
+    return load_id();
+}
+
+void glAttachShader(GLuint program, GLuint shader) {}
+
+void glDetachShader(GLuint program, GLuint shader) {}
+
+void glLinkProgram(GLuint program) {}
+
+void glProgramParameteri(GLuint program, GLenum pname, GLint value) {}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params) {
+    *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+void glProgramBinary(
+    GLuint program, GLenum binaryFormat, const void *binary, GLsizei length
+) {}
+
+void glGetProgramBinary(
+    GLuint program,
+    GLsizei bufSize,
+    GLsizei *length,
+    GLenum *binaryFormat,
+    void *binary
+) {
+    *length = 0;
+}
+
+void glDeleteProgram(GLuint program) {}
+
+void glGenBuffers(GLsizei n, GLuint *buffers) {
+    for (int i = 0; i < n; ++i) buffers[i] = load_id();
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint *buffers) {}
+
+void glBindBuffer(GLenum target, GLuint buffer) {}
+
+void glBufferData(
+    GLenum target, GLsizeiptr size, const void *data, GLenum usage
+) {}
+
+void *glMapBufferRange(
+    GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access
+) {
+    memset(PIXEL_BUFFER, 0, sizeof(PIXEL_BUFFER));
+    return PIXEL_BUFFER;
+}
+
+GLboolean glUnmapBuffer(GLenum target) {
+    return GL_TRUE;
+}
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+    N_FENCES += 1;
+    return (GLsync)(size_t)load_id();
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    return IS_GPU_BUSY ? GL_TIMEOUT_EXPIRED : GL_ALREADY_SIGNALED;
+}
+
+void glDeleteSync(GLsync sync) {
+    if (sync) N_FENCES -= 1;
+}
+#endif
@@ -0,0 +1,46 @@
+#ifndef RAYLIB_HEADLESS_H
+#define RAYLIB_HEADLESS_H
+
+#include "raylib.h"
+
+// Stand-in for the raylib window, input and rlgl functions raygizmo calls,
+// linked instead of raylib by the tests and the benchmarks. There is no
+// window and no GPU: the draws are only counted, the resources are ids, and
+// the GPU picking reads back empty pixels (nothing is picked). The screen
+// and the mouse are whatever was set below
+
+void headless_set_screen_size(int width, int height);
+void headless_set_mouse(Vector2 position, Vector2 delta, bool is_lmb_down);
+
+// Draw calls (vertex array draws and raylib shapes) since the last reset
+unsigned int headless_get_n_draw_calls(void);
+void headless_reset_n_draw_calls(void);
+
+// Added to GetTime, like a clock which has been running for that long
+void headless_set_time_offset(double offset);
+
+// TraceLog calls with LOG_WARNING, whatever the log level is
+int headless_get_n_warnings(void);
+
+// Widths of the lines drawn since the last reset, in the draw order. Like
+// rlgl, a line takes the width which is set when its batch is drawn
+int headless_get_line_widths(float *widths, int max_count);
+
+// The last rlSetUniformMatrix value (the mvp of the last gizmo draw)
+Matrix headless_get_uniform_matrix(void);
+
+// The last rlViewport (x, y, width, height)
+void headless_get_viewport(int viewport[4]);
+
+// The framebuffers are not complete while failing
+void headless_set_framebuffer_failing(bool is_failing);
+
+// The rlgl OpenGL version (an rlGlVersion), RL_OPENGL_33 by default
+void headless_set_gl_version(int version);
+
+// RAYLIB_HEADLESS_GL only: the GL fences stay unsignaled while the GPU is
+// busy, and the number of fences which are not deleted yet
+void headless_set_gpu_busy(bool is_busy);
+int headless_get_n_fences(void);
+
+#endif  // RAYLIB_HEADLESS_H
@@ -19,6 +19,68 @@ typedef enum RGizmoState {
     RGIZMO_STATE_ACTIVE_PLANE,
 } RGizmoState;
 
+typedef enum RGizmoPickMode {
+    // Render handle ids into the picking fbo and read back the mouse pixel
+    RGIZMO_PICK_GPU,
+
+    // Intersect the mouse ray with the handles geometry analytically
+    RGIZMO_PICK_CPU,
+
+    // Like RGIZMO_PICK_GPU, but only the mouse pixel is copied into a pixel
+    // buffer and consumed once the GPU is done with it, without stalling.
+    // Hover state lags behind the cursor by at least one frame (a press
+    // activates the handle that was hovered on the previous frames).
+    // Requires RAYGIZMO_DIRECT_GL, falls back to RGIZMO_PICK_GPU otherwise
+    RGIZMO_PICK_GPU_ASYNC,
+} RGizmoPickMode;
+
+// Everything rgizmo_update reads from the window and the mouse. Pass it to
+// rgizmo_update_ex to drive the gizmo deterministically (tests, replays)
+typedef struct RGizmoInput {
+    Vector2 mouse_position;
+    Vector2 mouse_delta;
+    bool is_lmb_down;
+    int screen_width;
+    int screen_height;
+} RGizmoInput;
+
+// Pointer position (in the same space as RGizmoInput.mouse_position) and
+// the left button state at the time, e.g. from the platform events
+typedef struct RGizmoPointerSample {
+    Vector2 position;
+    bool is_lmb_down;
+    double time;
+} RGizmoPointerSample;
+
+// What an update has changed, the updates return a mask of these
+typedef enum RGizmoChange {
+    RGIZMO_CHANGE_NONE = 0,
+
+    // The gizmo became hot or cold, or another handle became hot
+    RGIZMO_CHANGE_HOVER = 1 << 0,
+
+    // A drag has started or ended
+    RGIZMO_CHANGE_ACTIVE = 1 << 1,
+
+    // The update has a non-zero translation or angle
+    RGIZMO_CHANGE_TRANSFORM = 1 << 2,
+
+    // A drag has started or ended (together with RGIZMO_CHANGE_ACTIVE). A
+    // press and a release within one rgizmo_update_samples give both, and
+    // the drag totals cover the samples between them
+    RGIZMO_CHANGE_DRAG_BEGIN = 1 << 3,
+    RGIZMO_CHANGE_DRAG_END = 1 << 4,
+} RGizmoChange;
+
+// Draws the scene objects into the picking pass with the given id shader,
+// calling rgizmo_set_scene_id before the draws of every object. It runs in
+// the 3D mode of the gizmo camera with the depth test enabled
+typedef void (*RGizmoDrawSceneIds)(Shader shader, void *user_data);
+
+// Scene ids take the upper 24 bits of the picked value (the handle ids the
+// lowest byte), 0 means no object
+#define RGIZMO_SCENE_ID_MAX 0xFFFFFF
+
 typedef struct RGizmo {
     struct {
         Vector3 translation;
@@ -35,56 +97,710 @@ typedef struct RGizmo {
         float axis_handle_tip_radius;
         float plane_handle_offset;
         float plane_handle_size;
+
+        // Level of detail of the cone tips and of the draw list rings: one
+        // side per lod_side_pixels of their projected circumference, within
+        // lod_min_sides and lod_max_sides. The cones take the nearest of 4,
+        // 8, 16 and 32 sides at or above it
+        float lod_side_pixels;
+        int lod_min_sides;
+        int lod_max_sides;
     } view;
 
+    struct {
+        RGizmoPickMode mode;
+
+        // GPU modes only: render just the few pixels around the mouse cursor
+        // with a cursor-centered projection into a tiny picking target
+        bool cursor_frustum;
+
+        // With cursor_frustum: if the pixel under the cursor is empty, pick
+        // the nearest handle within this many pixels (0 disables)
+        int hover_radius;
+
+        // Handle id picked by the last update
+        unsigned char picked_id;
+
+        // GPU modes only: the scene objects drawn by this hook share the
+        // picking pass and its readback. They occlude each other, the gizmo
+        // is drawn over them. The pick cache doesn't know about the scene,
+        // invalidate it when the scene changes
+        RGizmoDrawSceneIds draw_scene_ids;
+        void *scene_user_data;
+
+        // Scene id picked by the last update, 0 if there is no object under
+        // the cursor or a handle covers it
+        unsigned int picked_scene_id;
+
+        // The picking pass is skipped and picked_id is reused while the
+        // picking inputs (camera, position, mouse position, view, screen
+        // size) stay the same, and while a handle is being dragged
+        struct {
+            unsigned long long key;
+            bool is_valid;
+            unsigned int n_hits;
+            unsigned int n_misses;
+
+            // Updates which skipped picking because the mouse cursor was
+            // outside of the gizmo screen bounds
+            unsigned int n_culls;
+        } cache;
+    } picking;
+
     RGizmoState state;
+
+    // The newest pointer sample consumed by rgizmo_update_samples, if it
+    // has consumed any
+    bool has_last_sample;
+    RGizmoPointerSample last_sample;
+
+    // The current drag, or the last one after it has ended: the gizmo
+    // position at its start and the totals of its updates
+    struct {
+        bool is_active;
+        Vector3 position;
+        Vector3 translation;
+        Vector3 axis;
+        float angle;
+    } drag;
+
+    // What the last update has seen and changed, for rgizmo_needs_redraw
+    struct {
+        unsigned int changes;
+        unsigned long long key;
+        Vector2 mouse_position;
+        bool is_lmb_down;
+    } redraw;
 } RGizmo;
 
+// GPU state of one viewport: the gizmo shader and the picking targets of
+// the viewport size. The functions below use the current context, which is
+// the window-sized default one unless another is set
+typedef struct RGizmoContext RGizmoContext;
+
+typedef enum RGizmoError {
+    RGIZMO_ERROR_NONE,
+
+    // A gizmo function was called before rgizmo_create or after
+    // rgizmo_unload, it did nothing
+    RGIZMO_ERROR_NOT_LOADED,
+
+    RGIZMO_ERROR_OUT_OF_MEMORY,
+
+    // The gizmo shaders failed to compile or link, the context doesn't
+    // draw the gizmos (its scene id shader: it picks on the CPU)
+    RGIZMO_ERROR_SHADER,
+
+    // A picking fbo is not complete, the context picks on the CPU
+    RGIZMO_ERROR_FRAMEBUFFER,
+} RGizmoError;
+
+// The first error since the last call, which clears it. The GPU resources
+// are created on their first use (the draws and the GPU picking passes),
+// so the errors come from there rather than from rgizmo_create
+RGizmoError rgizmo_get_error(void);
+
+// RAYGIZMO_DIRECT_GL only: the gizmo program binary is saved into this file
+// and loaded from it instead of compiling the shaders, if the driver
+// supports program binaries (a stale or foreign file is rebuilt). NULL
+// disables the cache, which is the default
+void rgizmo_set_program_cache(const char *file_name);
+
 void rgizmo_unload(void);
 
+// The viewport rectangle is in the window coordinates, rgizmo_get_input
+// maps the mouse into it. The gizmos of the context must be drawn into a
+// render target of the viewport size. Destroy contexts before rgizmo_unload.
+// Returns NULL if it can't be allocated
+RGizmoContext *rgizmo_context_create(Rectangle viewport);
+void rgizmo_context_destroy(RGizmoContext *context);
+void rgizmo_context_set_viewport(RGizmoContext *context, Rectangle viewport);
+
+// NULL sets the default context back
+void rgizmo_set_context(RGizmoContext *context);
+
 RGizmo rgizmo_create(void);
 
-void rgizmo_update(RGizmo *gizmo, Camera3D camera, Vector3 position);
+RGizmoInput rgizmo_get_input(void);
+
+// The updates return a mask of RGizmoChange
+unsigned int rgizmo_update(RGizmo *gizmo, Camera3D camera, Vector3 position);
+unsigned int rgizmo_update_ex(
+    RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+);
+
+// Like rgizmo_update_ex, but the drag is integrated over all pointer samples
+// collected since the last update (ordered by time, the older ones are
+// skipped), so the large rotation arcs stay correct at low frame rates. The
+// update is the total of the steps, the mouse ends at the newest sample
+unsigned int rgizmo_update_samples(
+    RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    const RGizmoPointerSample *samples,
+    int count
+);
+
+// The picked value keeps the gizmo index in 16 bits, so the updates of many
+// gizmos take at most this count (a larger one is rejected)
+#define RGIZMO_UPDATE_MANY_MAX 0xFFFF
+
+// Updates the gizmos with a single picking pass, at most one of them becomes
+// hot or active. The pass takes the picking settings of the first gizmo
+// (mode, cursor_frustum, hover_radius and the scene ids hook) for the whole
+// batch, the ones of the others are ignored with a warning if they differ
+unsigned int rgizmo_update_many(
+    RGizmo *gizmos, const Vector3 *positions, int count, Camera3D camera
+);
+unsigned int rgizmo_update_many_ex(
+    RGizmo *gizmos,
+    const Vector3 *positions,
+    int count,
+    Camera3D camera,
+    RGizmoInput input
+);
+
+// Whether the gizmo has to be updated and redrawn for this input: the last
+// update has changed something, the camera, position, view or screen size
+// are not the ones it has seen, or the input may change the hover or the
+// drag (the button changed on a hot or active gizmo, the cursor moved while
+// dragging or within the gizmo screen bounds), or an async readback of the
+// gizmo is still in flight. It neither picks nor touches GL, so an idle
+// editor may skip both rgizmo_update and rgizmo_draw
+bool rgizmo_needs_redraw(
+    const RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+);
+
+// The update split into two stages: picking (GPU modes need the GL thread)
+// and the interaction math, which touches no globals and no GL, so it may
+// run on any thread. rgizmo_update_ex is rgizmo_pick followed by
+// rgizmo_solve, with the output written back into the gizmo
+typedef struct RGizmoSolveInput {
+    RGizmoState state;
+    Vector3 axis;
+    unsigned char picked_id;
+    Camera3D camera;
+    Vector3 position;
+    RGizmoInput input;
+} RGizmoSolveInput;
+
+typedef struct RGizmoSolveOutput {
+    RGizmoState state;
+    Vector3 translation;
+    Vector3 axis;
+    float angle;
+} RGizmoSolveOutput;
+
+unsigned char rgizmo_pick(
+    RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+);
+void rgizmo_solve(const RGizmoSolveInput *in, RGizmoSolveOutput *out);
+
+void rgizmo_invalidate_pick_cache(RGizmo *gizmo);
+
+// Id (1..RGIZMO_SCENE_ID_MAX) of the following scene draws of the
+// draw_scene_ids hook. Flushes the rlgl batch, so the batched shapes may
+// be drawn with BeginShaderMode(shader)
+void rgizmo_set_scene_id(unsigned int id);
+Rectangle rgizmo_get_screen_bounds(
+    RGizmo gizmo, Camera3D camera, Vector3 position
+);
 void rgizmo_draw(RGizmo gizmo, Camera3D camera, Vector3 position);
+void rgizmo_draw_many(
+    const RGizmo *gizmos, const Vector3 *positions, int count, Camera3D camera
+);
 Matrix rgizmo_get_tranform(RGizmo gizmo, Vector3 position);
 
+// Total transform of the current (or the last) drag, relative to the drag
+// start. Snapshot the selection on RGIZMO_CHANGE_DRAG_BEGIN, preview it
+// with this matrix and write it once on RGIZMO_CHANGE_DRAG_END, instead of
+// accumulating rgizmo_get_tranform every frame (which drifts)
+Matrix rgizmo_get_drag_transform(RGizmo gizmo);
+
+// Vertex of the gizmo draw list: world space position, the handle color and
+// the handle id (as rgizmo_pick returns it)
+typedef struct RGizmoDrawVertex {
+    Vector3 position;
+    Color color;
+    unsigned char handle_id;
+} RGizmoDrawVertex;
+
+// Caller-owned arrays of an indexed triangle list. The gizmo triangles are
+// appended in the drawing order (draw without depth testing, later ones on
+// top), so set the counts to 0 to start over
+typedef struct RGizmoDrawList {
+    RGizmoDrawVertex *vertices;
+    unsigned short *indices;
+    int max_vertices;
+    int max_indices;
+    int n_vertices;
+    int n_indices;
+} RGizmoDrawList;
+
+// Upper bound of RGizmo.view.lod_max_sides
+#define RGIZMO_LOD_MAX_SIDES 128
+
+// Enough for one gizmo
+#define RGIZMO_DRAW_LIST_MAX_VERTICES 2916
+#define RGIZMO_DRAW_LIST_MAX_INDICES 2916
+
+// Appends the triangles rgizmo_draw draws, for the renderers other than
+// rlgl. Lines are extruded for the input screen size, and the rings are
+// tessellated with the lod of the view. Returns false (the list is
+// unchanged) if it doesn't fit
+bool rgizmo_build_draw_list(
+    RGizmo gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    RGizmoDrawList *list
+);
+
+// Handle id under the input mouse position, the last triangle wins. Works
+// without a window, like RGIZMO_PICK_CPU, and can be passed to rgizmo_solve
+unsigned char rgizmo_pick_draw_list(
+    const RGizmoDrawList *list, Camera3D camera, RGizmoInput input
+);
+
+typedef enum RGizmoPivot {
+    RGIZMO_PIVOT_CENTROID,
+    RGIZMO_PIVOT_BOUNDS_CENTER,
+} RGizmoPivot;
+
+// Structure of arrays of the selected objects: positions and optional
+// (NULL) rotations as unit quaternions
+typedef struct RGizmoTransforms {
+    float *x;
+    float *y;
+    float *z;
+    float *qx;
+    float *qy;
+    float *qz;
+    float *qw;
+    int count;
+} RGizmoTransforms;
+
+// Apply the gizmo update to many objects at once (the same as multiplying
+// every transform by rgizmo_get_tranform) and return the pivot of the
+// updated positions. The transforms of an idle gizmo are left unchanged, so
+// it also gives the initial pivot of a selection
+Vector3 rgizmo_apply_transform_batch(
+    RGizmo gizmo,
+    Vector3 position,
+    Matrix *transforms,
+    int count,
+    RGizmoPivot pivot
+);
+Vector3 rgizmo_apply_transform_batch_soa(
+    RGizmo gizmo,
+    Vector3 position,
+    RGizmoTransforms transforms,
+    RGizmoPivot pivot
+);
+
+typedef enum RGizmoPhase {
+    // Drawing the gizmos into the picking fbo
+    RGIZMO_PHASE_PICK_RENDER,
+
+    // Reading the picked pixels back (waits for the GPU in the sync mode)
+    RGIZMO_PHASE_PICK_READBACK,
+
+    // Interaction math of the update
+    RGIZMO_PHASE_SOLVE,
+
+    // rgizmo_draw and rgizmo_draw_many
+    RGIZMO_PHASE_DRAW,
+
+    RGIZMO_PHASE_COUNT,
+} RGizmoPhase;
+
+// Totals since the load or the last rgizmo_reset_stats, times in seconds
+typedef struct RGizmoStats {
+    struct {
+        unsigned int n_calls;
+        double cpu_time;
+        double cpu_time_max;
+
+        // RAYGIZMO_GPU_TIMERS only (with RAYGIZMO_DIRECT_GL): GL timer
+        // queries of the render phases, collected a few frames later
+        unsigned int n_gpu_samples;
+        double gpu_time;
+    } phases[RGIZMO_PHASE_COUNT];
+
+    // Issued for the gizmo handles, both drawing and picking
+    unsigned int n_draw_calls;
+    unsigned long long n_vertices;
+    unsigned int n_state_changes;
+} RGizmoStats;
+
+RGizmoStats rgizmo_get_stats(void);
+void rgizmo_reset_stats(void);
+
+// Chrome trace (chrome://tracing, Perfetto) JSON of the last phases
+bool rgizmo_save_chrome_trace(const char *file_name);
+
+// Binary trace of the rgizmo_update_ex arguments: a header followed by one
+// fixed-size little-endian record per frame
+#define RGIZMO_TRACE_VERSION 1
+#define RGIZMO_TRACE_HEADER_SIZE 8
+#define RGIZMO_TRACE_FRAME_SIZE 73
+
+typedef struct RGizmoTraceFrame {
+    RGizmoInput input;
+    Camera3D camera;
+    Vector3 position;
+} RGizmoTraceFrame;
+
+void rgizmo_trace_write_header(unsigned char *bytes);
+bool rgizmo_trace_read_header(const unsigned char *bytes, int size);
+void rgizmo_trace_write_frame(unsigned char *bytes, RGizmoTraceFrame frame);
+RGizmoTraceFrame rgizmo_trace_read_frame(const unsigned char *bytes);
+
+// Compact binary stream of the drags, to mirror them on other clients: the
+// drag begin and end records and the deltas of RGizmo.update in between,
+// quantized to the steps of the stream (the rounding error is carried into
+// the next delta, so it never adds up). One stream encodes the updates of
+// a gizmo, another one (on the receiver) decodes them. Both track the drag
+// totals of the quantized deltas, which are bitwise the same on both ends
+#define RGIZMO_DELTA_TRANSLATION_STEP 1e-4f
+#define RGIZMO_DELTA_ANGLE_STEP 1e-5f
+
+// Enough for one rgizmo_delta_write or rgizmo_delta_flush
+#define RGIZMO_DELTA_MAX_WRITE_SIZE 45
+
+typedef enum RGizmoDeltaType {
+    RGIZMO_DELTA_BEGIN,
+    RGIZMO_DELTA_END,
+    RGIZMO_DELTA_ROTATE,
+    RGIZMO_DELTA_TRANSLATE,
+} RGizmoDeltaType;
+
+// Decoded record. The position is the pivot of the delta: the drag start
+// plus the translation so far
+typedef struct RGizmoDelta {
+    RGizmoDeltaType type;
+    Vector3 position;
+    Vector3 axis;
+    Vector3 translation;
+    float angle;
+} RGizmoDelta;
+
+typedef struct RGizmoDeltaStream {
+    // World units and radians. The encoder sends its steps with every
+    // drag begin, the decoder takes them from there
+    float translation_step;
+    float angle_step;
+
+    // The drag as the stream has carried it so far
+    struct {
+        bool is_active;
+        Vector3 position;
+        Vector3 translation;
+        Vector3 axis;
+        float angle;
+    } drag;
+
+    // Encoder only: the delta being coalesced (not written yet) and the
+    // rounding error of the written ones, per world axis of the translation
+    // and per rotation axis of the angle
+    struct {
+        int type;
+        int axis_id;
+        Vector3 value;
+    } pending;
+    Vector3 translation_error;
+    Vector3 angle_error;
+} RGizmoDeltaStream;
+
+RGizmoDeltaStream rgizmo_delta_stream_create(void);
+
+// Encodes the update of the gizmo with the change mask the update has
+// returned. The deltas of the same kind and axis are coalesced until the
+// next rgizmo_delta_flush (call it before sending) or the drag end. Returns
+// the number of bytes written
+int rgizmo_delta_write(
+    RGizmoDeltaStream *stream,
+    RGizmo gizmo,
+    unsigned int changes,
+    unsigned char *bytes
+);
+int rgizmo_delta_flush(RGizmoDeltaStream *stream, unsigned char *bytes);
+
+// Decodes the record at the start of the bytes. Returns its size, or 0 if
+// it's truncated or invalid
+int rgizmo_delta_read(
+    RGizmoDeltaStream *stream,
+    const unsigned char *bytes,
+    int size,
+    RGizmoDelta *delta
+);
+
+// The transform of one decoded delta, like rgizmo_get_tranform, and of the
+// whole drag so far, like rgizmo_get_drag_transform
+Matrix rgizmo_delta_get_tranform(RGizmoDelta delta);
+Matrix rgizmo_delta_get_drag_transform(const RGizmoDeltaStream *stream);
+
 #ifdef RAYGIZMO_IMPLEMENTATION
 #include "raygizmo.h"
 #include "raylib.h"
 #include "raymath.h"
 #include "rlgl.h"
+#include <float.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// RAYGIZMO_DIRECT_GL lets raygizmo call OpenGL 3.3 functions which rlgl
+// doesn't expose. Define RAYGIZMO_GL_LOADED if the GL prototypes are already
+// provided by your own loader header, included before raygizmo.h
+#if defined(RAYGIZMO_DIRECT_GL) && !defined(RAYGIZMO_GL_LOADED)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+// SIMD kernels of the batch transform functions, define RAYGIZMO_NO_SIMD to
+// use the plain C ones
+#if !defined(RAYGIZMO_NO_SIMD)
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BATCH_AVX
+#endif
+#if defined(__SSE__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define BATCH_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BATCH_NEON
+#endif
+#endif
+
+// RAYGIZMO_GPU_TIMERS measures the GPU time of the render phases with
+// GL_TIME_ELAPSED queries (don't keep another one active around the gizmo
+// calls)
+#if defined(RAYGIZMO_GPU_TIMERS) && defined(RAYGIZMO_DIRECT_GL)
+#define STATS_GPU_TIMERS
+#endif
+
+// RAYGIZMO_BATCH_THREADS > 1 splits large batches across that many POSIX
+// threads (link with -lpthread)
+#if defined(RAYGIZMO_BATCH_THREADS) && RAYGIZMO_BATCH_THREADS > 1
+#include <pthread.h>
+#define BATCH_THREADS RAYGIZMO_BATCH_THREADS
+#else
+#define BATCH_THREADS 1
+#endif
+
+// The gizmo mesh is built once in the unit space (gizmo radius is 1) and
+// drawn instanced, one instance per gizmo. The vertex position is position *
+// dot(weights, params) + offset * dot(offsetWeights, offsetParams), where
+// params come from the instance view, so the mesh never changes. Vertices
+// with non-zero tangent.w belong to the lines, they are extruded in the
+// screen space by the half of the instance line width plus one pixel, which
+// the fragment shader fades out.
+// The axis and plane handles are drawn slot by slot, from the farthest one
+// to the nearest: the mesh has the X handle geometry for every slot
+// (vertexSlot) and the shader rotates it into the handle which falls into
+// this slot by the distance to the camera, so nothing is sorted on the CPU.
+// A rotation ring is a single quad around its projection, position and
+// offset are the ring axes and tangent.xy is the quad corner. The vertex
+// shader maps the screen onto the ring plane (adjugate of the plane to
+// screen homography, tilted a bit if the ring is edge-on), the fragment
+// shader gets the signed distance to the ring, converts it into pixels with
+// the derivatives and cuts the back half. The same shader draws the picking
+// pass (pickingPass selects the second half of colors, the ids), where the
+// fragments are written with no anti-aliasing. The scene shader writes the
+// scene ids of the picking pass, with the zero handle id byte
 #if defined(PLATFORM_DESKTOP)  // Shaders for PLATFORM_DESKTOP
 static const char *SHADER_VERT = "\
 #version 330\n\
 in vec3 vertexPosition; \
-in vec4 vertexColor; \
+in vec4 vertexWeights; \
+in vec3 vertexOffset; \
+in vec2 vertexOffsetWeights; \
+in vec4 vertexTangent; \
+in float vertexHandle; \
+in float vertexSlot; \
+in vec4 instancePosition; \
+in vec4 instanceParams; \
+in vec4 instanceParams2; \
 out vec4 fragColor; \
-out vec3 fragPosition; \
+out vec3 fragEdge; \
+out vec3 fragRing; \
+out vec3 fragToCenter; \
+out vec3 fragU; \
+out vec3 fragV; \
+out float fragHandle; \
 uniform mat4 mvp; \
+uniform vec4 colors[18]; \
+uniform vec4 hotColor; \
+uniform vec2 viewportSize; \
+uniform vec3 cameraPosition; \
+uniform float pickingPass; \
+vec3 rotate_axes(vec3 v, float k) \
+{ \
+    if (k > 1.5) return v.yzx; \
+    if (k > 0.5) return v.zxy; \
+    return v; \
+} \
+float get_handle_dist(vec3 p) \
+{ \
+    return dot(p - cameraPosition, p - cameraPosition); \
+} \
+float get_slot_handle(float slot, bool isPlane) \
+{ \
+    vec3 center = instancePosition.xyz; \
+    vec3 e = instancePosition.w * vec3(instanceParams.x); \
+    if (isPlane) e = instancePosition.w * instanceParams.z * vec3(-1.0); \
+    if (isPlane) center += instancePosition.w * vec3(instanceParams.z); \
+    vec3 d = vec3(get_handle_dist(center + vec3(e.x, 0.0, 0.0)), \
+                  get_handle_dist(center + vec3(0.0, e.y, 0.0)), \
+                  get_handle_dist(center + vec3(0.0, 0.0, e.z))); \
+    float r0 = float(d.y > d.x) + float(d.z > d.x); \
+    float r1 = float(d.x >= d.y) + float(d.z > d.y); \
+    if (r0 == slot) return 0.0; \
+    if (r1 == slot) return 1.0; \
+    return 2.0; \
+} \
+vec4 get_ring_quad(vec3 center, vec3 u, vec3 v, float halfWidth) \
+{ \
+    vec4 a = mvp * vec4(center - u - v, 1.0); \
+    vec4 b = mvp * vec4(center + u - v, 1.0); \
+    vec4 c = mvp * vec4(center - u + v, 1.0); \
+    vec4 d = mvp * vec4(center + u + v, 1.0); \
+    vec2 lo = vec2(-1.0); \
+    vec2 hi = vec2(1.0); \
+    if (min(min(a.w, b.w), min(c.w, d.w)) > 0.0) { \
+        vec2 margin = (2.0 * halfWidth + 2.0) / viewportSize; \
+        lo = min(min(a.xy / a.w, b.xy / b.w), min(c.xy / c.w, d.xy / d.w)); \
+        hi = max(max(a.xy / a.w, b.xy / b.w), max(c.xy / c.w, d.xy / d.w)); \
+        lo -= margin; \
+        hi += margin; \
+    } \
+    vec2 ndc = mix(lo, hi, 0.5 + 0.5 * vertexTangent.xy); \
+    vec3 h0 = (mvp * vec4(u, 0.0)).xyw; \
+    vec3 h1 = (mvp * vec4(v, 0.0)).xyw; \
+    vec3 h2 = (mvp * vec4(center, 1.0)).xyw; \
+    float det = dot(h0, cross(h1, h2)); \
+    if (abs(det) < 1e-4 * length(h0) * length(h1) * length(h2)) { \
+        h1 = (mvp * vec4(v + 0.002 * cross(u, v) / length(u), 0.0)).xyw; \
+        det = dot(h0, cross(h1, h2)); \
+    } \
+    vec3 p = vec3(ndc, 1.0); \
+    fragRing = sign(det) \
+               * vec3(dot(cross(h1, h2), p), \
+                      dot(cross(h2, h0), p), \
+                      dot(cross(h0, h1), p)); \
+    return vec4(ndc, 0.0, 1.0); \
+} \
 void main() \
 { \
-    fragColor = vertexColor; \
-    fragPosition = vertexPosition; \
-    gl_Position = mvp * vec4(vertexPosition, 1.0); \
+    float handle = vertexHandle; \
+    vec3 position = vertexPosition; \
+    vec3 offset = vertexOffset; \
+    vec3 tangent = vertexTangent.xyz; \
+    if (vertexSlot >= 0.0) { \
+        float k = get_slot_handle(vertexSlot, vertexHandle > 5.5); \
+        handle += k; \
+        position = rotate_axes(position, k); \
+        offset = rotate_axes(offset, k); \
+        tangent = rotate_axes(tangent, k); \
+    } \
+    float radius = instancePosition.w; \
+    float halfWidth = 0.5 * instanceParams2.y; \
+    vec4 clip; \
+    fragEdge = vec3(0.0, 1.0, pickingPass); \
+    fragRing = vec3(0.0, 0.0, 1.0); \
+    fragToCenter = instancePosition.xyz - cameraPosition; \
+    fragU = radius * position; \
+    fragV = radius * offset; \
+    if (handle < 2.5) { \
+        fragEdge.y = halfWidth; \
+        clip = get_ring_quad(instancePosition.xyz, fragU, fragV, halfWidth); \
+    } else { \
+        vec4 params = vec4(1.0, instanceParams.xyz); \
+        vec2 offsetParams = vec2(instanceParams.w, instanceParams2.x); \
+        vec3 p = instancePosition.xyz \
+                 + radius \
+                       * (position * dot(vertexWeights, params) \
+                          + offset * dot(vertexOffsetWeights, offsetParams)); \
+        clip = mvp * vec4(p, 1.0); \
+        if (vertexTangent.w != 0.0) { \
+            vec4 next = mvp * vec4(p + 0.01 * radius * tangent, 1.0); \
+            vec2 dir = (next.xy / next.w - clip.xy / clip.w) * viewportSize; \
+            if (dot(dir, dir) > 0.0) { \
+                vec2 normal = normalize(vec2(-dir.y, dir.x)); \
+                clip.xy += normal * vertexTangent.w * (2.0 * halfWidth + 2.0) \
+                           / viewportSize * clip.w; \
+            } \
+            fragEdge.x = vertexTangent.w * (halfWidth + 1.0); \
+            fragEdge.y = halfWidth; \
+        } \
+    } \
+    float index = instanceParams2.w; \
+    fragColor = colors[int(handle + 9.0 * pickingPass)] \
+                + vec4(0.0, mod(index, 256.0), floor(index / 256.0), 0.0) \
+                      / 255.0; \
+    if (handle == instanceParams2.z) fragColor = hotColor; \
+    fragHandle = handle; \
+    gl_Position = clip; \
 } \
 ";
 
 static const char *SHADER_FRAG = "\
 #version 330\n\
 in vec4 fragColor; \
-in vec3 fragPosition; \
-uniform vec3 cameraPosition; \
-uniform vec3 gizmoPosition; \
+in vec3 fragEdge; \
+in vec3 fragRing; \
+in vec3 fragToCenter; \
+in vec3 fragU; \
+in vec3 fragV; \
+in float fragHandle; \
 out vec4 finalColor; \
 void main() \
 { \
-    vec3 r = normalize(fragPosition - gizmoPosition); \
-    vec3 c = normalize(fragPosition - cameraPosition); \
-    if (dot(r, c) > 0.1) discard; \
+    float dist = abs(fragEdge.x); \
+    vec2 uv = fragRing.xy / fragRing.z; \
+    float ring = length(uv) - 1.0; \
+    vec2 grad = vec2(dFdx(ring), dFdy(ring)); \
+    if (fragHandle < 2.5) { \
+        if (fragRing.z <= 0.0) discard; \
+        dist = abs(ring) / max(length(grad), 1e-6); \
+    } \
+    float coverage = clamp(fragEdge.y + 0.5 - dist, 0.0, 1.0); \
+    if (coverage <= 0.0 || (fragEdge.z > 0.5 && coverage < 0.5)) discard; \
+    if (fragHandle < 2.5) { \
+        uv = normalize(uv); \
+        vec3 r = fragU * uv.x + fragV * uv.y; \
+        vec3 c = normalize(fragToCenter + r); \
+        if (dot(normalize(r), c) > 0.1) discard; \
+    } \
     finalColor = fragColor; \
+    if (fragEdge.z < 0.5) finalColor.a *= coverage; \
+} \
+";
+
+static const char *SCENE_SHADER_VERT = "\
+#version 330\n\
+in vec3 vertexPosition; \
+uniform mat4 mvp; \
+void main() \
+{ \
+    gl_Position = mvp * vec4(vertexPosition, 1.0); \
+} \
+";
+
+static const char *SCENE_SHADER_FRAG = "\
+#version 330\n\
+uniform vec4 sceneId; \
+out vec4 finalColor; \
+void main() \
+{ \
+    finalColor = sceneId; \
 } \
 ";
 
@@ -93,36 +809,211 @@ void main() \
 static const char *SHADER_VERT = "\
 #version 100\n\
 attribute vec3 vertexPosition; \
-attribute vec4 vertexColor; \
+attribute vec4 vertexWeights; \
+attribute vec3 vertexOffset; \
+attribute vec2 vertexOffsetWeights; \
+attribute vec4 vertexTangent; \
+attribute float vertexHandle; \
+attribute float vertexSlot; \
+attribute vec4 instancePosition; \
+attribute vec4 instanceParams; \
+attribute vec4 instanceParams2; \
 varying vec4 fragColor; \
-varying vec3 fragPosition; \
+varying vec3 fragEdge; \
+varying vec3 fragRing; \
+varying vec3 fragToCenter; \
+varying vec3 fragU; \
+varying vec3 fragV; \
+varying float fragHandle; \
 uniform mat4 mvp; \
+uniform vec4 colors[18]; \
+uniform vec4 hotColor; \
+uniform vec2 viewportSize; \
+uniform vec3 cameraPosition; \
+uniform float pickingPass; \
+vec3 rotate_axes(vec3 v, float k) \
+{ \
+    if (k > 1.5) return v.yzx; \
+    if (k > 0.5) return v.zxy; \
+    return v; \
+} \
+float get_handle_dist(vec3 p) \
+{ \
+    return dot(p - cameraPosition, p - cameraPosition); \
+} \
+float get_slot_handle(float slot, bool isPlane) \
+{ \
+    vec3 center = instancePosition.xyz; \
+    vec3 e = instancePosition.w * vec3(instanceParams.x); \
+    if (isPlane) e = instancePosition.w * instanceParams.z * vec3(-1.0); \
+    if (isPlane) center += instancePosition.w * vec3(instanceParams.z); \
+    vec3 d = vec3(get_handle_dist(center + vec3(e.x, 0.0, 0.0)), \
+                  get_handle_dist(center + vec3(0.0, e.y, 0.0)), \
+                  get_handle_dist(center + vec3(0.0, 0.0, e.z))); \
+    float r0 = float(d.y > d.x) + float(d.z > d.x); \
+    float r1 = float(d.x >= d.y) + float(d.z > d.y); \
+    if (r0 == slot) return 0.0; \
+    if (r1 == slot) return 1.0; \
+    return 2.0; \
+} \
+vec4 get_ring_quad(vec3 center, vec3 u, vec3 v, float halfWidth) \
+{ \
+    vec4 a = mvp * vec4(center - u - v, 1.0); \
+    vec4 b = mvp * vec4(center + u - v, 1.0); \
+    vec4 c = mvp * vec4(center - u + v, 1.0); \
+    vec4 d = mvp * vec4(center + u + v, 1.0); \
+    vec2 lo = vec2(-1.0); \
+    vec2 hi = vec2(1.0); \
+    if (min(min(a.w, b.w), min(c.w, d.w)) > 0.0) { \
+        vec2 margin = (2.0 * halfWidth + 2.0) / viewportSize; \
+        lo = min(min(a.xy / a.w, b.xy / b.w), min(c.xy / c.w, d.xy / d.w)); \
+        hi = max(max(a.xy / a.w, b.xy / b.w), max(c.xy / c.w, d.xy / d.w)); \
+        lo -= margin; \
+        hi += margin; \
+    } \
+    vec2 ndc = mix(lo, hi, 0.5 + 0.5 * vertexTangent.xy); \
+    vec3 h0 = (mvp * vec4(u, 0.0)).xyw; \
+    vec3 h1 = (mvp * vec4(v, 0.0)).xyw; \
+    vec3 h2 = (mvp * vec4(center, 1.0)).xyw; \
+    float det = dot(h0, cross(h1, h2)); \
+    if (abs(det) < 1e-4 * length(h0) * length(h1) * length(h2)) { \
+        h1 = (mvp * vec4(v + 0.002 * cross(u, v) / length(u), 0.0)).xyw; \
+        det = dot(h0, cross(h1, h2)); \
+    } \
+    vec3 p = vec3(ndc, 1.0); \
+    fragRing = sign(det) \
+               * vec3(dot(cross(h1, h2), p), \
+                      dot(cross(h2, h0), p), \
+                      dot(cross(h0, h1), p)); \
+    return vec4(ndc, 0.0, 1.0); \
+} \
 void main() \
 { \
-    fragColor = vertexColor; \
-    fragPosition = vertexPosition; \
-    gl_Position = mvp * vec4(vertexPosition, 1.0); \
+    float handle = vertexHandle; \
+    vec3 position = vertexPosition; \
+    vec3 offset = vertexOffset; \
+    vec3 tangent = vertexTangent.xyz; \
+    if (vertexSlot >= 0.0) { \
+        float k = get_slot_handle(vertexSlot, vertexHandle > 5.5); \
+        handle += k; \
+        position = rotate_axes(position, k); \
+        offset = rotate_axes(offset, k); \
+        tangent = rotate_axes(tangent, k); \
+    } \
+    float radius = instancePosition.w; \
+    float halfWidth = 0.5 * instanceParams2.y; \
+    vec4 clip; \
+    fragEdge = vec3(0.0, 1.0, pickingPass); \
+    fragRing = vec3(0.0, 0.0, 1.0); \
+    fragToCenter = instancePosition.xyz - cameraPosition; \
+    fragU = radius * position; \
+    fragV = radius * offset; \
+    if (handle < 2.5) { \
+        fragEdge.y = halfWidth; \
+        clip = get_ring_quad(instancePosition.xyz, fragU, fragV, halfWidth); \
+    } else { \
+        vec4 params = vec4(1.0, instanceParams.xyz); \
+        vec2 offsetParams = vec2(instanceParams.w, instanceParams2.x); \
+        vec3 p = instancePosition.xyz \
+                 + radius \
+                       * (position * dot(vertexWeights, params) \
+                          + offset * dot(vertexOffsetWeights, offsetParams)); \
+        clip = mvp * vec4(p, 1.0); \
+        if (vertexTangent.w != 0.0) { \
+            vec4 next = mvp * vec4(p + 0.01 * radius * tangent, 1.0); \
+            vec2 dir = (next.xy / next.w - clip.xy / clip.w) * viewportSize; \
+            if (dot(dir, dir) > 0.0) { \
+                vec2 normal = normalize(vec2(-dir.y, dir.x)); \
+                clip.xy += normal * vertexTangent.w * (2.0 * halfWidth + 2.0) \
+                           / viewportSize * clip.w; \
+            } \
+            fragEdge.x = vertexTangent.w * (halfWidth + 1.0); \
+            fragEdge.y = halfWidth; \
+        } \
+    } \
+    float index = instanceParams2.w; \
+    fragColor = colors[int(handle + 9.0 * pickingPass)] \
+                + vec4(0.0, mod(index, 256.0), floor(index / 256.0), 0.0) \
+                      / 255.0; \
+    if (handle == instanceParams2.z) fragColor = hotColor; \
+    fragHandle = handle; \
+    gl_Position = clip; \
 } \
 ";
 
 static const char *SHADER_FRAG = "\
 #version 100\n\
-precision mediump float; \
+#extension GL_OES_standard_derivatives : enable\n\
+#ifdef GL_FRAGMENT_PRECISION_HIGH\n\
+precision highp float;\n\
+#else\n\
+precision mediump float;\n\
+#endif\n\
 varying vec4 fragColor; \
-varying vec3 fragPosition; \
-uniform vec3 cameraPosition; \
-uniform vec3 gizmoPosition; \
-void main() { \
-    vec3 r = normalize(fragPosition - gizmoPosition); \
-    vec3 c = normalize(fragPosition - cameraPosition); \
-    if (dot(r, c) > 0.1) discard; \
+varying vec3 fragEdge; \
+varying vec3 fragRing; \
+varying vec3 fragToCenter; \
+varying vec3 fragU; \
+varying vec3 fragV; \
+varying float fragHandle; \
+void main() \
+{ \
+    float dist = abs(fragEdge.x); \
+    vec2 uv = fragRing.xy / fragRing.z; \
+    float ring = length(uv) - 1.0; \
+    vec2 grad = vec2(dFdx(ring), dFdy(ring)); \
+    if (fragHandle < 2.5) { \
+        if (fragRing.z <= 0.0) discard; \
+        dist = abs(ring) / max(length(grad), 1e-6); \
+    } \
+    float coverage = clamp(fragEdge.y + 0.5 - dist, 0.0, 1.0); \
+    if (coverage <= 0.0 || (fragEdge.z > 0.5 && coverage < 0.5)) discard; \
+    if (fragHandle < 2.5) { \
+        uv = normalize(uv); \
+        vec3 r = fragU * uv.x + fragV * uv.y; \
+        vec3 c = normalize(fragToCenter + r); \
+        if (dot(normalize(r), c) > 0.1) discard; \
+    } \
     gl_FragColor = fragColor; \
+    if (fragEdge.z < 0.5) gl_FragColor.a *= coverage; \
+} \
+";
+
+static const char *SCENE_SHADER_VERT = "\
+#version 100\n\
+attribute vec3 vertexPosition; \
+uniform mat4 mvp; \
+void main() \
+{ \
+    gl_Position = mvp * vec4(vertexPosition, 1.0); \
+} \
+";
+
+static const char *SCENE_SHADER_FRAG = "\
+#version 100\n\
+precision mediump float; \
+uniform vec4 sceneId; \
+void main() \
+{ \
+    gl_FragColor = sceneId; \
 } \
 ";
 #endif
 
-#define PICKING_FBO_WIDTH 512
-#define PICKING_FBO_HEIGHT 512
+#define PICKING_REGION_SIZE 8
+#define PICKING_PBO_COUNT 4
+#define PICKING_MAX_PBOS 64
+#define PICKING_MAX_CANDIDATES 64
+
+#define PICK_RING_SEGMENTS 72
+
+// The axis handles are built once per cone lod, with MESH_MIN_CONE_SIDES <<
+// lod sides
+#define MESH_N_CONE_LODS 4
+#define MESH_MIN_CONE_SIDES 4
+#define MESH_N_VERTICES \
+    (3 * (6 + 6) + 3 * 6 * MESH_N_CONE_LODS \
+     + 3 * 6 * MESH_MIN_CONE_SIDES * ((1 << MESH_N_CONE_LODS) - 1))
 
 #define X_AXIS \
     (Vector3) { 1.0, 0.0, 0.0 }
@@ -141,12 +1032,245 @@ void main() { \
     } while (0)
 
 static bool IS_LOADED = false;
-static Shader SHADER;
-static int SHADER_CAMERA_POSITION_LOC;
-static int SHADER_GIZMO_POSITION_LOC;
 
-static unsigned int PICKING_FBO;
-static unsigned int PICKING_TEXTURE;
+// Unit space gizmo vertex, see the comment above SHADER_VERT
+typedef struct MeshVertex {
+    Vector3 position;
+    float weights[4];
+    Vector3 offset;
+    float offset_weights[2];
+    Vector4 tangent;
+    float handle;
+    float slot;  // draw slot of the axis and plane handles, -1 for the rings
+} MeshVertex;
+
+// Per-gizmo instance data, see the comment above SHADER_VERT
+typedef struct MeshInstance {
+    Vector4 position;  // xyz: gizmo position, w: gizmo radius
+    Vector4 params;  // axis length, tip length, plane offset, tip radius
+    Vector4 params2;  // plane size, line width, hot handle, picking index
+} MeshInstance;
+
+typedef struct MeshAttrib {
+    const char *name;
+    int size;
+    size_t offset;
+    bool is_instance;
+} MeshAttrib;
+
+#define MESH_N_ATTRIBS 10
+static const MeshAttrib MESH_ATTRIBS[MESH_N_ATTRIBS] = {
+    {"vertexPosition", 3, offsetof(MeshVertex, position), false},
+    {"vertexWeights", 4, offsetof(MeshVertex, weights), false},
+    {"vertexOffset", 3, offsetof(MeshVertex, offset), false},
+    {"vertexOffsetWeights", 2, offsetof(MeshVertex, offset_weights), false},
+    {"vertexTangent", 4, offsetof(MeshVertex, tangent), false},
+    {"vertexHandle", 1, offsetof(MeshVertex, handle), false},
+    {"vertexSlot", 1, offsetof(MeshVertex, slot), false},
+    {"instancePosition", 4, offsetof(MeshInstance, position), true},
+    {"instanceParams", 4, offsetof(MeshInstance, params), true},
+    {"instanceParams2", 4, offsetof(MeshInstance, params2), true}};
+
+typedef struct MeshRange {
+    int offset;
+    int count;
+} MeshRange;
+
+static MeshVertex MESH_VERTICES[MESH_N_VERTICES];
+static unsigned int MESH_VBO;
+
+// The generation is bumped whenever the instance buffer is reallocated, so
+// the vertex arrays of the contexts know they point to a stale one
+static MeshInstance *MESH_INSTANCES;
+static int MESH_INSTANCE_CAPACITY;
+static unsigned int MESH_INSTANCE_VBO;
+static unsigned int MESH_INSTANCE_GENERATION;
+static MeshRange MESH_ROT_RANGE;
+static MeshRange MESH_AXIS_RANGES[MESH_N_CONE_LODS][3];
+static MeshRange MESH_PLANE_RANGES[3];
+
+#if defined(RAYGIZMO_DIRECT_GL)
+// Pixel buffer of the async readbacks. The owner is the address of the
+// gizmo (or of the gizmo array) which has queued it, the frame is the
+// number of the readbacks queued by the context before it and the key is
+// the pick key of the readback
+typedef struct PickingPbo {
+    GLuint id;
+    GLsync fence;
+    int size;
+    const void *owner;
+    unsigned int frame;
+    unsigned long long key;
+} PickingPbo;
+#endif
+
+// The mesh buffers are shared by all contexts, the vertex array is not,
+// since it's bound to the attribute locations of the context shader. The
+// picking fbo has the size of the viewport (an empty viewport rectangle
+// means the whole window). Everything is created on the first use, and a
+// resource which has failed is not retried (the context doesn't draw or
+// picks on the CPU instead), except the picking targets, which are retried
+// once the viewport changes
+struct RGizmoContext {
+    Rectangle viewport;
+    bool is_shader_failed;
+    bool is_picking_failed;
+
+    unsigned int shader_id;
+    int shader_mvp_loc;
+    int shader_viewport_size_loc;
+    int shader_camera_position_loc;
+    int shader_picking_pass_loc;
+
+    Shader scene_shader;
+    int scene_shader_id_loc;
+
+    int attrib_locs[MESH_N_ATTRIBS];
+    unsigned int vao;
+    unsigned int instance_generation;
+
+    unsigned int picking_fbo;
+    unsigned int picking_texture;
+    int picking_width;
+    int picking_height;
+    unsigned int picking_region_fbo;
+    unsigned int picking_region_texture;
+
+#if defined(RAYGIZMO_DIRECT_GL)
+    PickingPbo *picking_pbos;
+    int n_picking_pbos;
+    unsigned int picking_frame;
+#endif
+};
+
+static RGizmoContext DEFAULT_CONTEXT;
+static RGizmoContext *CONTEXT = &DEFAULT_CONTEXT;
+
+// ---------------------------------------------------------------------------
+// Errors
+static RGizmoError LAST_ERROR;
+static char PROGRAM_CACHE_FILE[1024];
+
+static void set_error(RGizmoError error, const char *message) {
+    TraceLog(LOG_ERROR, "RAYGIZMO: %s", message);
+    if (LAST_ERROR == RGIZMO_ERROR_NONE) LAST_ERROR = error;
+}
+
+static bool check_is_loaded(void) {
+    if (!IS_LOADED) set_error(RGIZMO_ERROR_NOT_LOADED, "Gizmo is not loaded");
+    return IS_LOADED;
+}
+
+// ---------------------------------------------------------------------------
+// Stats
+#define STATS_MAX_EVENTS 4096
+#define STATS_N_QUERIES 8
+
+typedef struct StatsEvent {
+    RGizmoPhase phase;
+    double start;
+    double duration;
+} StatsEvent;
+
+static const char *PHASE_NAMES[RGIZMO_PHASE_COUNT] = {
+    "pick_render", "pick_readback", "solve", "draw"};
+
+static RGizmoStats STATS;
+static StatsEvent STATS_EVENTS[STATS_MAX_EVENTS];
+static unsigned int STATS_N_EVENTS;
+static double STATS_PICK_START;
+
+#if defined(STATS_GPU_TIMERS)
+// A ring of queries per phase, a query is reused once its result is read
+typedef struct GpuTimer {
+    GLuint queries[STATS_N_QUERIES];
+    bool is_pending[STATS_N_QUERIES];
+    int next;
+    bool is_running;
+} GpuTimer;
+
+static GpuTimer STATS_TIMERS[RGIZMO_PHASE_COUNT];
+static bool STATS_TIMERS_LOADED;
+
+static void collect_gpu_timer(RGizmoPhase phase) {
+    GpuTimer *timer = &STATS_TIMERS[phase];
+    for (int i = 0; i < STATS_N_QUERIES; ++i) {
+        if (!timer->is_pending[i]) continue;
+
+        GLint is_available = 0;
+        glGetQueryObjectiv(
+            timer->queries[i], GL_QUERY_RESULT_AVAILABLE, &is_available
+        );
+        if (!is_available) continue;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(timer->queries[i], GL_QUERY_RESULT, &ns);
+        STATS.phases[phase].gpu_time += 1e-9 * (double)ns;
+        STATS.phases[phase].n_gpu_samples += 1;
+        timer->is_pending[i] = false;
+    }
+}
+
+static void begin_gpu_timer(RGizmoPhase phase) {
+    if (!STATS_TIMERS_LOADED) {
+        for (int i = 0; i < RGIZMO_PHASE_COUNT; ++i) {
+            glGenQueries(STATS_N_QUERIES, STATS_TIMERS[i].queries);
+        }
+        STATS_TIMERS_LOADED = true;
+    }
+
+    // Skip the measurement if all queries are still in flight
+    GpuTimer *timer = &STATS_TIMERS[phase];
+    collect_gpu_timer(phase);
+    timer->is_running = !timer->is_pending[timer->next];
+    if (timer->is_running) {
+        glBeginQuery(GL_TIME_ELAPSED, timer->queries[timer->next]);
+    }
+}
+
+static void end_gpu_timer(RGizmoPhase phase) {
+    GpuTimer *timer = &STATS_TIMERS[phase];
+    if (!timer->is_running) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->is_pending[timer->next] = true;
+    timer->next = (timer->next + 1) % STATS_N_QUERIES;
+    timer->is_running = false;
+}
+
+static void unload_gpu_timers(void) {
+    if (!STATS_TIMERS_LOADED) return;
+    for (int i = 0; i < RGIZMO_PHASE_COUNT; ++i) {
+        glDeleteQueries(STATS_N_QUERIES, STATS_TIMERS[i].queries);
+        GpuTimer empty = {0};
+        STATS_TIMERS[i] = empty;
+    }
+    STATS_TIMERS_LOADED = false;
+}
+#else
+#define begin_gpu_timer(phase) ((void)0)
+#define end_gpu_timer(phase) ((void)0)
+#endif
+
+static void end_phase(RGizmoPhase phase, double start) {
+    double duration = GetTime() - start;
+    STATS.phases[phase].n_calls += 1;
+    STATS.phases[phase].cpu_time += duration;
+    if (duration > STATS.phases[phase].cpu_time_max) {
+        STATS.phases[phase].cpu_time_max = duration;
+    }
+
+    StatsEvent event = {phase, start, duration};
+    STATS_EVENTS[STATS_N_EVENTS++ % STATS_MAX_EVENTS] = event;
+}
+
+static void add_draw_stats(
+    int n_draw_calls, int n_vertices, int n_state_changes
+) {
+    STATS.n_draw_calls += n_draw_calls;
+    STATS.n_vertices += n_vertices;
+    STATS.n_state_changes += n_state_changes;
+}
 
 typedef enum HandleId {
     HANDLE_X,
@@ -173,6 +1297,7 @@ typedef struct Handle {
     Vector3 axis;
     Color color;
     float distToCamera;
+    int idx;
 } Handle;
 
 typedef struct XYZColors {
@@ -191,6 +1316,17 @@ typedef struct Handles {
     Handle arr[3];
 } Handles;
 
+static const HandleColors PICKING_COLORS = {
+    {{ROT_HANDLE_X, 0, 0, 0},
+     {ROT_HANDLE_Y, 0, 0, 0},
+     {ROT_HANDLE_Z, 0, 0, 0}},
+    {{AXIS_HANDLE_X, 0, 0, 0},
+     {AXIS_HANDLE_Y, 0, 0, 0},
+     {AXIS_HANDLE_Z, 0, 0, 0}},
+    {{PLANE_HANDLE_X, 0, 0, 0},
+     {PLANE_HANDLE_Y, 0, 0, 0},
+     {PLANE_HANDLE_Z, 0, 0, 0}}};
+
 static Handles sort_handles(Handle h0, Handle h1, Handle h2) {
     if (h0.distToCamera < h1.distToCamera) SWAP(h0, h1);
     if (h1.distToCamera < h2.distToCamera) SWAP(h1, h2);
@@ -200,425 +1336,3936 @@ static Handles sort_handles(Handle h0, Handle h1, Handle h2) {
     return handles;
 }
 
-static XYZColors get_xyz_colors(Vector3 current_axis, bool is_hot) {
-    Color x = is_hot && current_axis.x == 1.0f ? WHITE : RED;
-    Color y = is_hot && current_axis.y == 1.0f ? WHITE : GREEN;
-    Color z = is_hot && current_axis.z == 1.0f ? WHITE : BLUE;
-    XYZColors colors = {x, y, z};
-    return colors;
+static float get_gizmo_radius(
+    RGizmo gizmo, Camera3D camera, Vector3 position
+) {
+    return gizmo.view.size * Vector3Distance(camera.position, position);
 }
 
-static void draw_gizmo(
-    RGizmo gizmo, Camera3D camera, Vector3 position, HandleColors colors
+// Projected radius in pixels of a sphere around the position, for the
+// viewport height. FLT_MAX if the position is not in front of the camera
+static float get_screen_radius(
+    Camera3D camera, Vector3 position, float radius, float height
 ) {
-    float radius = gizmo.view.size * Vector3Distance(camera.position, position);
+    float half_height = 0.5f * camera.fovy;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        Vector3 forward = Vector3Normalize(
+            Vector3Subtract(camera.target, camera.position)
+        );
+        float depth = Vector3DotProduct(
+            Vector3Subtract(position, camera.position), forward
+        );
+        if (depth <= EPSILON) return FLT_MAX;
+        half_height = depth * tanf(0.5f * camera.fovy * DEG2RAD);
+    }
+    return 0.5f * height * radius / half_height;
+}
 
-    BeginMode3D(camera);
-    rlSetLineWidth(gizmo.view.handle_draw_thickness);
-    rlDisableDepthTest();
+// Side count of a circle of the projected radius, see RGizmo.view
+static int get_lod_sides(RGizmo gizmo, float screen_radius) {
+    int min_sides = gizmo.view.lod_min_sides;
+    if (min_sides < 3) min_sides = 3;
+    int max_sides = (int)Clamp(
+        gizmo.view.lod_max_sides, min_sides, RGIZMO_LOD_MAX_SIDES
+    );
+    float n_sides = 2.0f * PI * screen_radius
+                    / fmaxf(gizmo.view.lod_side_pixels, 1.0f);
+    return (int)Clamp(ceilf(n_sides), min_sides, max_sides);
+}
 
-    // ---------------------------------------------------------------
-    // Draw plane handles
-    {
-        float offset = radius * gizmo.view.plane_handle_offset;
-        float size = radius * gizmo.view.plane_handle_size;
-
-        Vector3 px = Vector3Add(position, (Vector3){0.0f, offset, offset});
-        Vector3 py = Vector3Add(position, (Vector3){offset, 0.0f, offset});
-        Vector3 pz = Vector3Add(position, (Vector3){offset, offset, 0.0f});
-
-        Handle hx = {
-            px,
-            Z_AXIS,
-            colors.plane.x,
-            Vector3DistanceSqr(px, camera.position)};
-        Handle hy = {
-            py,
-            Y_AXIS,
-            colors.plane.y,
-            Vector3DistanceSqr(py, camera.position)};
-        Handle hz = {
-            pz,
-            X_AXIS,
-            colors.plane.z,
-            Vector3DistanceSqr(pz, camera.position)};
-        Handles handles = sort_handles(hx, hy, hz);
-
-        rlDisableBackfaceCulling();
-        for (int i = 0; i < 3; ++i) {
-            Handle *h = &handles.arr[i];
-            rlPushMatrix();
-            rlTranslatef(h->position.x, h->position.y, h->position.z);
-            rlRotatef(90.0f, h->axis.x, h->axis.y, h->axis.z);
-            DrawPlane(
-                Vector3Zero(), Vector2Scale(Vector2One(), size), h->color
-            );
-            rlPopMatrix();
-        }
+// Cone lod of the mesh for the gizmo in the viewport of this height
+static int get_cone_lod(
+    RGizmo gizmo, Camera3D camera, Vector3 position, float height
+) {
+    float radius = get_gizmo_radius(gizmo, camera, position)
+                   * gizmo.view.axis_handle_tip_radius;
+    int n_sides = get_lod_sides(
+        gizmo, get_screen_radius(camera, position, radius, height)
+    );
+    int lod = 0;
+    while (lod + 1 < MESH_N_CONE_LODS
+           && (MESH_MIN_CONE_SIDES << lod) < n_sides) {
+        lod += 1;
     }
+    return lod;
+}
 
-    // ---------------------------------------------------------------
-    // Draw rotation handles
-    {
-        BeginShaderMode(SHADER);
-        SetShaderValue(
-            SHADER,
-            SHADER_CAMERA_POSITION_LOC,
-            &camera.position,
-            SHADER_UNIFORM_VEC3
-        );
-        SetShaderValue(
-            SHADER, SHADER_GIZMO_POSITION_LOC, &position, SHADER_UNIFORM_VEC3
-        );
-        DrawCircle3D(position, radius, Y_AXIS, 90.0f, colors.rot.x);
-        DrawCircle3D(position, radius, X_AXIS, 90.0f, colors.rot.y);
-        DrawCircle3D(position, radius, X_AXIS, 0.0f, colors.rot.z);
-        EndShaderMode();
-    }
+static Handles get_plane_handles(
+    RGizmo gizmo, Camera3D camera, Vector3 position, XYZColors colors
+) {
+    float offset = get_gizmo_radius(gizmo, camera, position)
+                   * gizmo.view.plane_handle_offset;
 
-    // ---------------------------------------------------------------
-    // Draw axis handles
-    {
-        float length = radius * gizmo.view.axis_handle_length;
-        float tip_length = radius * gizmo.view.axis_handle_tip_length;
-        float tip_radius = radius * gizmo.view.axis_handle_tip_radius;
+    Vector3 px = Vector3Add(position, (Vector3){0.0f, offset, offset});
+    Vector3 py = Vector3Add(position, (Vector3){offset, 0.0f, offset});
+    Vector3 pz = Vector3Add(position, (Vector3){offset, offset, 0.0f});
 
-        Vector3 px = Vector3Add(position, Vector3Scale(X_AXIS, length));
-        Vector3 py = Vector3Add(position, Vector3Scale(Y_AXIS, length));
-        Vector3 pz = Vector3Add(position, Vector3Scale(Z_AXIS, length));
+    Handle hx = {
+        px,
+        Z_AXIS,
+        colors.x,
+        Vector3DistanceSqr(px, camera.position),
+        0};
+    Handle hy = {
+        py,
+        Y_AXIS,
+        colors.y,
+        Vector3DistanceSqr(py, camera.position),
+        1};
+    Handle hz = {
+        pz,
+        X_AXIS,
+        colors.z,
+        Vector3DistanceSqr(pz, camera.position),
+        2};
+    return sort_handles(hx, hy, hz);
+}
 
-        Handle hx = {
-            px, X_AXIS, colors.axis.x, Vector3DistanceSqr(px, camera.position)};
-        Handle hy = {
-            py, Y_AXIS, colors.axis.y, Vector3DistanceSqr(py, camera.position)};
-        Handle hz = {
-            pz, Z_AXIS, colors.axis.z, Vector3DistanceSqr(pz, camera.position)};
-        Handles handles = sort_handles(hx, hy, hz);
+static Handles get_axis_handles(
+    RGizmo gizmo, Camera3D camera, Vector3 position, XYZColors colors
+) {
+    float length = get_gizmo_radius(gizmo, camera, position)
+                   * gizmo.view.axis_handle_length;
 
-        for (int i = 0; i < 3; ++i) {
-            Handle *h = &handles.arr[i];
-            Vector3 tip_end = Vector3Add(
-                h->position, Vector3Scale(h->axis, tip_length)
+    Vector3 px = Vector3Add(position, Vector3Scale(X_AXIS, length));
+    Vector3 py = Vector3Add(position, Vector3Scale(Y_AXIS, length));
+    Vector3 pz = Vector3Add(position, Vector3Scale(Z_AXIS, length));
+
+    Handle hx = {
+        px,
+        X_AXIS,
+        colors.x,
+        Vector3DistanceSqr(px, camera.position),
+        0};
+    Handle hy = {
+        py,
+        Y_AXIS,
+        colors.y,
+        Vector3DistanceSqr(py, camera.position),
+        1};
+    Handle hz = {
+        pz,
+        Z_AXIS,
+        colors.z,
+        Vector3DistanceSqr(pz, camera.position),
+        2};
+    return sort_handles(hx, hy, hz);
+}
+
+// ---------------------------------------------------------------------------
+// Gizmo mesh
+static const float MESH_W_NONE[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+static const float MESH_W_ONE[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+static const float MESH_W_LENGTH[4] = {0.0f, 1.0f, 0.0f, 0.0f};
+static const float MESH_W_TIP[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+static const float MESH_W_PLANE_OFFSET[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+static const float MESH_W_NO_OFFSET[2] = {0.0f, 0.0f};
+static const float MESH_W_TIP_RADIUS[2] = {1.0f, 0.0f};
+static const float MESH_W_PLANE_SIZE[2] = {0.0f, 1.0f};
+
+static void push_mesh_vertex(
+    int *n_vertices,
+    Vector3 position,
+    const float *weights,
+    Vector3 offset,
+    const float *offset_weights,
+    Vector4 tangent,
+    int handle
+) {
+    MeshVertex *v = &MESH_VERTICES[(*n_vertices)++];
+    v->position = position;
+    memcpy(v->weights, weights, sizeof(v->weights));
+    v->offset = offset;
+    memcpy(v->offset_weights, offset_weights, sizeof(v->offset_weights));
+    v->tangent = tangent;
+    v->handle = (float)handle;
+    v->slot = -1.0f;
+}
+
+static void push_mesh_triangle(
+    int *n_vertices,
+    const Vector3 *positions,
+    const float *const *weights,
+    const Vector3 *offsets,
+    const float *const *offset_weights,
+    int handle
+) {
+    for (int i = 0; i < 3; ++i) {
+        push_mesh_vertex(
+            n_vertices,
+            positions[i],
+            weights[i],
+            offsets[i],
+            offset_weights[i],
+            (Vector4){0.0f, 0.0f, 0.0f, 0.0f},
+            handle
+        );
+    }
+}
+
+// Two triangles which are extruded into a screen space ribbon by the shader
+static void push_mesh_line(
+    int *n_vertices,
+    Vector3 start,
+    const float *start_weights,
+    Vector3 end,
+    const float *end_weights,
+    Vector3 tangent,
+    int handle
+) {
+    Vector3 positions[6] = {start, start, end, start, end, end};
+    const float *weights[6] = {
+        start_weights,
+        start_weights,
+        end_weights,
+        start_weights,
+        end_weights,
+        end_weights};
+    float sides[6] = {-1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f};
+
+    for (int i = 0; i < 6; ++i) {
+        push_mesh_vertex(
+            n_vertices,
+            positions[i],
+            weights[i],
+            Vector3Zero(),
+            MESH_W_NO_OFFSET,
+            (Vector4){tangent.x, tangent.y, tangent.z, sides[i]},
+            handle
+        );
+    }
+}
+
+static void set_mesh_slot(MeshRange range, int slot) {
+    for (int i = range.offset; i < range.offset + range.count; ++i) {
+        MESH_VERTICES[i].slot = (float)slot;
+    }
+}
+
+// Builds the same geometry the immediate mode functions used to draw:
+// DrawCircle3D rings, DrawLine3D + DrawCylinderEx axes and DrawPlane planes.
+// Handle index selects the color from the colors uniform, it follows the
+// HandleColors layout: rot x, y, z, axis x, y, z, plane x, y, z.
+// The axis and plane handles are built as the X handle once per slot (the
+// axis handles once per cone lod too), the shader rotates them into the
+// handle which falls into the slot
+static void build_gizmo_mesh(void) {
+    Vector3 a = X_AXIS;
+    Vector3 b1 = Y_AXIS;
+    Vector3 b2 = Z_AXIS;
+    int n = 0;
+
+    // ---------------------------------------------------------------
+    // Rotation handles: one quad per ring, the points of the ring are
+    // sin * u + cos * v, as DrawCircle3D draws them
+    {
+        Vector3 u[3] = {Vector3Negate(Z_AXIS), X_AXIS, X_AXIS};
+        Vector3 v[3] = {Y_AXIS, Z_AXIS, Y_AXIS};
+        float corners[6][2] = {
+            {-1.0f, -1.0f},
+            {1.0f, -1.0f},
+            {1.0f, 1.0f},
+            {-1.0f, -1.0f},
+            {1.0f, 1.0f},
+            {-1.0f, 1.0f}};
+
+        MESH_ROT_RANGE.offset = n;
+        for (int i = 0; i < 3; ++i) {
+            for (int k = 0; k < 6; ++k) {
+                push_mesh_vertex(
+                    &n,
+                    u[i],
+                    MESH_W_ONE,
+                    v[i],
+                    MESH_W_NO_OFFSET,
+                    (Vector4){corners[k][0], corners[k][1], 0.0f, 0.0f},
+                    i
+                );
+            }
+        }
+        MESH_ROT_RANGE.count = n - MESH_ROT_RANGE.offset;
+    }
+
+    // ---------------------------------------------------------------
+    // Axis handles: shaft line and the tip cone with its base cap
+    for (int i = 0; i < 3 * MESH_N_CONE_LODS; ++i) {
+        int lod = i / 3;
+        int slot = i % 3;
+        int n_sides = MESH_MIN_CONE_SIDES << lod;
+        MeshRange *range = &MESH_AXIS_RANGES[lod][slot];
+        range->offset = n;
+        push_mesh_line(&n, a, MESH_W_NONE, a, MESH_W_LENGTH, a, 3);
+        for (int k = 0; k < n_sides; ++k) {
+            float a0 = 2.0f * PI * k / n_sides;
+            float a1 = 2.0f * PI * (k + 1) / n_sides;
+            Vector3 r0 = Vector3Add(
+                Vector3Scale(b1, cosf(a0)), Vector3Scale(b2, sinf(a0))
+            );
+            Vector3 r1 = Vector3Add(
+                Vector3Scale(b1, cosf(a1)), Vector3Scale(b2, sinf(a1))
+            );
+
+            Vector3 side_positions[3] = {a, a, a};
+            const float *side_weights[3] = {
+                MESH_W_LENGTH, MESH_W_LENGTH, MESH_W_TIP};
+            Vector3 side_offsets[3] = {r0, r1, Vector3Zero()};
+            const float *side_offset_weights[3] = {
+                MESH_W_TIP_RADIUS, MESH_W_TIP_RADIUS, MESH_W_NO_OFFSET};
+            push_mesh_triangle(
+                &n,
+                side_positions,
+                side_weights,
+                side_offsets,
+                side_offset_weights,
+                3
             );
-            DrawLine3D(position, h->position, h->color);
-            DrawCylinderEx(
-                h->position, tip_end, tip_radius, 0.0f, 16, h->color
+
+            const float *cap_weights[3] = {
+                MESH_W_LENGTH, MESH_W_LENGTH, MESH_W_LENGTH};
+            Vector3 cap_offsets[3] = {Vector3Zero(), r1, r0};
+            const float *cap_offset_weights[3] = {
+                MESH_W_NO_OFFSET, MESH_W_TIP_RADIUS, MESH_W_TIP_RADIUS};
+            push_mesh_triangle(
+                &n,
+                side_positions,
+                cap_weights,
+                cap_offsets,
+                cap_offset_weights,
+                3
             );
         }
+        range->count = n - range->offset;
+        set_mesh_slot(*range, slot);
     }
-    EndMode3D();
 
     // ---------------------------------------------------------------
-    // Draw long white line which represents current active axis
-    if (gizmo.state == RGIZMO_STATE_ACTIVE_ROT
-        || gizmo.state == RGIZMO_STATE_ACTIVE_AXIS) {
-        BeginMode3D(camera);
-        rlSetLineWidth(gizmo.view.active_axis_draw_thickness);
-        Vector3 halfAxisLine = Vector3Scale(gizmo.update.axis, 1000.0f);
-        DrawLine3D(
-            Vector3Subtract(position, halfAxisLine),
-            Vector3Add(position, halfAxisLine),
-            WHITE
-        );
-        EndMode3D();
+    // Plane handles: quads in the plane orthogonal to the handle axis
+    for (int slot = 0; slot < 3; ++slot) {
+        Vector3 center = Vector3Add(b1, b2);
+        Vector3 corners[4];
+        for (int k = 0; k < 4; ++k) {
+            corners[k] = Vector3Add(
+                Vector3Scale(b1, k & 1 ? 0.5f : -0.5f),
+                Vector3Scale(b2, k & 2 ? 0.5f : -0.5f)
+            );
+        }
+
+        Vector3 positions[3] = {center, center, center};
+        const float *weights[3] = {
+            MESH_W_PLANE_OFFSET, MESH_W_PLANE_OFFSET, MESH_W_PLANE_OFFSET};
+        const float *offset_weights[3] = {
+            MESH_W_PLANE_SIZE, MESH_W_PLANE_SIZE, MESH_W_PLANE_SIZE};
+        Vector3 t0[3] = {corners[0], corners[1], corners[3]};
+        Vector3 t1[3] = {corners[0], corners[3], corners[2]};
+
+        MESH_PLANE_RANGES[slot].offset = n;
+        push_mesh_triangle(&n, positions, weights, t0, offset_weights, 6);
+        push_mesh_triangle(&n, positions, weights, t1, offset_weights, 6);
+        MESH_PLANE_RANGES[slot].count = n - MESH_PLANE_RANGES[slot].offset;
+        set_mesh_slot(MESH_PLANE_RANGES[slot], slot);
     }
+}
 
-    // ---------------------------------------------------------------
-    // Draw white line from the gizmo's center to the mouse cursor when rotating
-    if (gizmo.state == RGIZMO_STATE_ACTIVE_ROT) {
-        rlSetLineWidth(gizmo.view.active_axis_draw_thickness);
-        DrawLineV(
-            GetWorldToScreen(position, camera), GetMousePosition(), WHITE
+static void set_mesh_attributes(const int *locs, bool is_instance) {
+    int stride = is_instance ? sizeof(MeshInstance) : sizeof(MeshVertex);
+    for (int i = 0; i < MESH_N_ATTRIBS; ++i) {
+        const MeshAttrib *attrib = &MESH_ATTRIBS[i];
+        int loc = locs[i];
+        if (attrib->is_instance != is_instance || loc < 0) continue;
+
+        rlSetVertexAttribute(
+            loc,
+            attrib->size,
+            RL_FLOAT,
+            false,
+            stride,
+            (const void *)attrib->offset
         );
+        rlSetVertexAttributeDivisor(loc, is_instance ? 1 : 0);
+        rlEnableVertexAttribute(loc);
     }
 }
 
-static void rgizmo_load(void) {
-    if (IS_LOADED) {
-        TraceLog(LOG_WARNING, "RAYGIZMO: Gizmo is already loaded, skip");
-        return;
+// Without vertex array objects (OpenGL ES 2.0 without the extension) the
+// attributes are set up again on every bind
+static void bind_gizmo_mesh(RGizmoContext *context) {
+    if (!rlEnableVertexArray(context->vao)) {
+        rlEnableVertexBuffer(MESH_VBO);
+        set_mesh_attributes(context->attrib_locs, false);
+        rlEnableVertexBuffer(MESH_INSTANCE_VBO);
+        set_mesh_attributes(context->attrib_locs, true);
+    } else if (context->instance_generation != MESH_INSTANCE_GENERATION) {
+        rlEnableVertexBuffer(MESH_INSTANCE_VBO);
+        set_mesh_attributes(context->attrib_locs, true);
+        context->instance_generation = MESH_INSTANCE_GENERATION;
     }
+}
 
-    // -------------------------------------------------------------------
-    // Load shader
-    SHADER = LoadShaderFromMemory(SHADER_VERT, SHADER_FRAG);
-    SHADER_CAMERA_POSITION_LOC = GetShaderLocation(SHADER, "cameraPosition");
-    SHADER_GIZMO_POSITION_LOC = GetShaderLocation(SHADER, "gizmoPosition");
+// rlgl has no instanced draws on OpenGL 1.1 and 2.1, and on OpenGL ES 2.0
+// they depend on an extension, so there every gizmo is drawn on its own
+static bool has_instanced_draws(void) {
+    int version = rlGetVersion();
+    return version != RL_OPENGL_11 && version != RL_OPENGL_21
+           && version != RL_OPENGL_ES_20;
+}
 
-    // -------------------------------------------------------------------
-    // Load picking fbo
-    PICKING_FBO = rlLoadFramebuffer(PICKING_FBO_WIDTH, PICKING_FBO_HEIGHT);
-    if (!PICKING_FBO) {
-        TraceLog(LOG_ERROR, "RAYGIZMO: Failed to create picking fbo");
-        exit(1);
-    }
-    rlEnableFramebuffer(PICKING_FBO);
-
-    PICKING_TEXTURE = rlLoadTexture(
-        NULL,
-        PICKING_FBO_WIDTH,
-        PICKING_FBO_HEIGHT,
-        RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
-        1
-    );
-    rlActiveDrawBuffers(1);
-    rlFramebufferAttach(
-        PICKING_FBO,
-        PICKING_TEXTURE,
-        RL_ATTACHMENT_COLOR_CHANNEL0,
-        RL_ATTACHMENT_TEXTURE2D,
-        0
+// Without instanced draws the instance attributes are not arrays, every
+// gizmo sets their constant values before its draw
+static void disable_instance_attributes(const RGizmoContext *context) {
+    for (int i = 0; i < MESH_N_ATTRIBS; ++i) {
+        int loc = context->attrib_locs[i];
+        if (!MESH_ATTRIBS[i].is_instance || loc < 0) continue;
+        rlSetVertexAttributeDivisor(loc, 0);
+        rlDisableVertexAttribute(loc);
+    }
+}
+
+static void set_instance_attributes(
+    const RGizmoContext *context, const MeshInstance *instance
+) {
+    for (int i = 0; i < MESH_N_ATTRIBS; ++i) {
+        int loc = context->attrib_locs[i];
+        if (!MESH_ATTRIBS[i].is_instance || loc < 0) continue;
+        const void *value = (const char *)instance + MESH_ATTRIBS[i].offset;
+        rlSetVertexAttributeDefault(loc, value, RL_SHADER_ATTRIB_VEC4, 1);
+    }
+}
+
+static void unbind_gizmo_mesh(const RGizmoContext *context) {
+    if (!context->vao) {
+        for (int i = 0; i < MESH_N_ATTRIBS; ++i) {
+            int loc = context->attrib_locs[i];
+            if (loc < 0) continue;
+            rlSetVertexAttributeDivisor(loc, 0);
+            rlDisableVertexAttribute(loc);
+        }
+    }
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+}
+
+// Grows the instance buffer, so it can hold at least count gizmos
+static bool reserve_mesh_instances(int count) {
+    if (count <= MESH_INSTANCE_CAPACITY) return true;
+
+    int capacity = MESH_INSTANCE_CAPACITY * 2;
+    if (capacity < count) capacity = count;
+    MeshInstance *instances = (MeshInstance *)realloc(
+        MESH_INSTANCES, capacity * sizeof(MeshInstance)
     );
-    if (!rlFramebufferComplete(PICKING_FBO)) {
-        TraceLog(LOG_ERROR, "RAYGIZMO: Picking fbo is not complete");
-        exit(1);
+    if (!instances) {
+        set_error(RGIZMO_ERROR_OUT_OF_MEMORY, "Failed to allocate instances");
+        return false;
     }
+    MESH_INSTANCES = instances;
+    MESH_INSTANCE_CAPACITY = capacity;
 
-    IS_LOADED = true;
-    TraceLog(LOG_INFO, "RAYGIZMO: Gizmo loaded");
+    if (MESH_INSTANCE_VBO) rlUnloadVertexBuffer(MESH_INSTANCE_VBO);
+    MESH_INSTANCE_VBO = rlLoadVertexBuffer(
+        NULL, capacity * sizeof(MeshInstance), true
+    );
+    rlDisableVertexBuffer();
+    MESH_INSTANCE_GENERATION += 1;
+    return true;
 }
 
-void rgizmo_unload(void) {
-    if (!IS_LOADED) {
-        TraceLog(LOG_WARNING, "RAYGIZMO: Gizmo is already unloaded, skip");
-        return;
+// The shared mesh buffers, created on the first draw or GPU picking pass
+static bool require_gizmo_mesh(void) {
+    if (MESH_VBO) return true;
+
+    if (MESH_ROT_RANGE.count == 0) build_gizmo_mesh();
+    MESH_VBO = rlLoadVertexBuffer(
+        MESH_VERTICES, sizeof(MESH_VERTICES), false
+    );
+    rlDisableVertexBuffer();
+    return reserve_mesh_instances(16);
+}
+
+static void unload_gizmo_mesh(void) {
+    if (MESH_VBO) rlUnloadVertexBuffer(MESH_VBO);
+    if (MESH_INSTANCE_VBO) rlUnloadVertexBuffer(MESH_INSTANCE_VBO);
+    free(MESH_INSTANCES);
+    MESH_INSTANCES = NULL;
+    MESH_INSTANCE_CAPACITY = 0;
+    MESH_VBO = 0;
+    MESH_INSTANCE_VBO = 0;
+}
+
+// The vertex array of the context: the shared mesh buffers bound to the
+// attribute locations of the context shader
+static void load_context_mesh(RGizmoContext *context) {
+    for (int i = 0; i < MESH_N_ATTRIBS; ++i) {
+        context->attrib_locs[i] = rlGetLocationAttrib(
+            context->shader_id, MESH_ATTRIBS[i].name
+        );
     }
 
-    UnloadShader(SHADER);
-    rlUnloadFramebuffer(PICKING_FBO);
-    rlUnloadTexture(PICKING_TEXTURE);
+    context->vao = rlLoadVertexArray();
+    if (!context->vao) return;
 
-    IS_LOADED = false;
-    TraceLog(LOG_INFO, "RAYGIZMO: Gizmo unloaded");
+    rlEnableVertexArray(context->vao);
+    rlEnableVertexBuffer(MESH_VBO);
+    set_mesh_attributes(context->attrib_locs, false);
+    rlEnableVertexBuffer(MESH_INSTANCE_VBO);
+    set_mesh_attributes(context->attrib_locs, true);
+    context->instance_generation = MESH_INSTANCE_GENERATION;
+    unbind_gizmo_mesh(context);
 }
 
-RGizmo rgizmo_create(void) {
-    if (!IS_LOADED) rgizmo_load();
-    RGizmo gizmo = {0};
-    gizmo.view.size = 0.12f;
-    gizmo.view.handle_draw_thickness = 5.0f;
-    gizmo.view.active_axis_draw_thickness = 2.0f;
-    gizmo.view.axis_handle_length = 1.2f;
-    gizmo.view.axis_handle_tip_length = 0.3f;
-    gizmo.view.axis_handle_tip_radius = 0.1f;
-    gizmo.view.plane_handle_offset = 0.4f;
-    gizmo.view.plane_handle_size = 0.2f;
+// The projection matrix of the camera for the screen size of the input
+static Matrix get_camera_projection(Camera3D camera, RGizmoInput input) {
+    double aspect = (double)input.screen_width / (double)input.screen_height;
+    if (camera.projection == CAMERA_PERSPECTIVE) {
+        return MatrixPerspective(
+            camera.fovy * DEG2RAD,
+            aspect,
+            RL_CULL_DISTANCE_NEAR,
+            RL_CULL_DISTANCE_FAR
+        );
+    } else if (camera.projection == CAMERA_ORTHOGRAPHIC) {
+        double top = camera.fovy / 2.0;
+        double right = top * aspect;
+        return MatrixOrtho(
+            -right,
+            right,
+            -top,
+            top,
+            RL_CULL_DISTANCE_NEAR,
+            RL_CULL_DISTANCE_FAR
+        );
+    }
+    return MatrixIdentity();
+}
 
-    return gizmo;
+// Render target the gizmos are drawn into: its viewport size in pixels (the
+// lines thickness is measured in them), the input whose screen size gives
+// the projection aspect (BeginMode3D takes the window one) if it's not the
+// screen pass, and the optional pick matrix which is applied on top of the
+// camera projection
+typedef struct DrawPass {
+    Vector2 size;
+    bool has_input;
+    RGizmoInput input;
+    bool has_pick_matrix;
+    Matrix pick_matrix;
+} DrawPass;
+
+static DrawPass get_screen_pass(void) {
+    DrawPass pass = {0};
+    pass.size = (Vector2){
+        (float)rlGetFramebufferWidth(), (float)rlGetFramebufferHeight()};
+    pass.pick_matrix = MatrixIdentity();
+    return pass;
 }
 
-void rgizmo_update(RGizmo *gizmo, Camera3D camera, Vector3 position) {
-    if (!IS_LOADED) {
-        TraceLog(LOG_ERROR, "RAYGIZMO: Gizmo is not loaded");
-        exit(1);
+static void begin_gizmo_mode_3d(Camera3D camera, DrawPass pass) {
+    BeginMode3D(camera);
+    if (pass.has_input) {
+        rlSetMatrixProjection(get_camera_projection(camera, pass.input));
+    }
+    if (pass.has_pick_matrix) {
+        rlSetMatrixProjection(
+            MatrixMultiply(rlGetMatrixProjection(), pass.pick_matrix)
+        );
     }
+}
 
-    // -------------------------------------------------------------------
-    // Draw gizmo into the picking fbo for the mouse pixel-picking
-    rlEnableFramebuffer(PICKING_FBO);
-    rlViewport(0, 0, PICKING_FBO_WIDTH, PICKING_FBO_HEIGHT);
-    rlClearColor(0, 0, 0, 0);
-    rlClearScreenBuffers();
-    rlDisableColorBlend();
+// Handle which is drawn with the hot color (index in the HandleColors
+// layout, as in build_gizmo_mesh), or -1 if there is none
+static int get_hot_handle(RGizmo gizmo) {
+    int group;
+    switch (gizmo.state) {
+        case RGIZMO_STATE_HOT_ROT:
+        case RGIZMO_STATE_ACTIVE_ROT: group = 0; break;
+        case RGIZMO_STATE_HOT_AXIS:
+        case RGIZMO_STATE_ACTIVE_AXIS: group = 3; break;
+        case RGIZMO_STATE_HOT_PLANE:
+        case RGIZMO_STATE_ACTIVE_PLANE: group = 6; break;
+        default: return -1;
+    }
 
-    HandleColors colors = {
-        {(Color){ROT_HANDLE_X, 0, 0, 0},
-         (Color){ROT_HANDLE_Y, 0, 0, 0},
-         (Color){ROT_HANDLE_Z, 0, 0, 0}},
-        {(Color){AXIS_HANDLE_X, 0, 0, 0},
-         (Color){AXIS_HANDLE_Y, 0, 0, 0},
-         (Color){AXIS_HANDLE_Z, 0, 0, 0}},
-        {(Color){PLANE_HANDLE_X, 0, 0, 0},
-         (Color){PLANE_HANDLE_Y, 0, 0, 0},
-         (Color){PLANE_HANDLE_Z, 0, 0, 0}}};
+    if (gizmo.update.axis.x == 1.0f) return group;
+    if (gizmo.update.axis.y == 1.0f) return group + 1;
+    if (gizmo.update.axis.z == 1.0f) return group + 2;
+    return -1;
+}
 
-    draw_gizmo(*gizmo, camera, position, colors);
+static MeshInstance get_mesh_instance(
+    RGizmo gizmo,
+    Camera3D camera,
+    Vector3 position,
+    int hot_handle,
+    int picking_index
+) {
+    float radius = get_gizmo_radius(gizmo, camera, position);
+    MeshInstance instance = {
+        {position.x, position.y, position.z, radius},
+        {gizmo.view.axis_handle_length,
+         gizmo.view.axis_handle_tip_length,
+         gizmo.view.plane_handle_offset,
+         gizmo.view.axis_handle_tip_radius},
+        {gizmo.view.plane_handle_size,
+         gizmo.view.handle_draw_thickness,
+         (float)hot_handle,
+         (float)picking_index}};
+    return instance;
+}
 
-    rlDisableFramebuffer();
-    rlEnableColorBlend();
-    rlViewport(0, 0, GetScreenWidth(), GetScreenHeight());
+// The handle colors and the picking ids (the second half of the colors),
+// they never change, so they are set once per shader
+static void set_constant_uniforms(unsigned int shader_id) {
+    XYZColors xyz = {RED, GREEN, BLUE};
+    HandleColors sets[2] = {{xyz, xyz, xyz}, PICKING_COLORS};
+    Vector4 colors[18];
+    for (int i = 0; i < 2; ++i) {
+        HandleColors c = sets[i];
+        Color set[9] = {
+            c.rot.x,
+            c.rot.y,
+            c.rot.z,
+            c.axis.x,
+            c.axis.y,
+            c.axis.z,
+            c.plane.x,
+            c.plane.y,
+            c.plane.z};
+        for (int k = 0; k < 9; ++k) colors[9 * i + k] = ColorNormalize(set[k]);
+    }
+    Vector4 hot_color = ColorNormalize(WHITE);
 
-    // -------------------------------------------------------------------
-    // Pick the pixel under the mouse cursor
-    Vector2 mouse_position = GetMousePosition();
-    unsigned char *pixels = (unsigned char *)rlReadTexturePixels(
-        PICKING_TEXTURE,
-        PICKING_FBO_WIDTH,
-        PICKING_FBO_HEIGHT,
-        RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    rlEnableShader(shader_id);
+    rlSetUniform(
+        rlGetLocationUniform(shader_id, "colors"),
+        colors,
+        RL_SHADER_UNIFORM_VEC4,
+        18
     );
-
-    float x_fract = Clamp(mouse_position.x / (float)GetScreenWidth(), 0.0, 1.0);
-    float y_fract = Clamp(
-        1.0 - (mouse_position.y / (float)GetScreenHeight()), 0.0, 1.0
+    rlSetUniform(
+        rlGetLocationUniform(shader_id, "hotColor"),
+        &hot_color,
+        RL_SHADER_UNIFORM_VEC4,
+        1
     );
-    int x = (int)(PICKING_FBO_WIDTH * x_fract);
-    int y = (int)(PICKING_FBO_HEIGHT * y_fract);
-    int idx = 4 * (y * PICKING_FBO_WIDTH + x);
-    unsigned char picked_id = pixels[idx];
-
-    free(pixels);
+    rlDisableShader();
+}
 
-    // -------------------------------------------------------------------
-    // Update gizmo
-    gizmo->update.angle = 0.0;
-    gizmo->update.translation = Vector3Zero();
+static unsigned long long hash_bytes(
+    unsigned long long hash, const void *data, size_t size
+) {
+    // FNV-1a
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
 
-    bool is_lmb_down = IsMouseButtonDown(0);
-    if (!is_lmb_down) gizmo->state = RGIZMO_STATE_COLD;
+#if defined(RAYGIZMO_DIRECT_GL)
+// Program binary cache file: magic, key of the shader sources and the
+// driver, binary format and the binary itself (native endianness, the
+// file is only valid on this machine anyway)
+#define PROGRAM_CACHE_MAGIC 0x425A4752
+#define PROGRAM_CACHE_HEADER_SIZE 16
 
-    if (gizmo->state < RGIZMO_STATE_ACTIVE) {
-        if (picked_id < HANDLE_Y) gizmo->update.axis = X_AXIS;
-        else if (picked_id < HANDLE_Z) gizmo->update.axis = Y_AXIS;
-        else gizmo->update.axis = Z_AXIS;
+static bool has_program_binaries(void) {
+    GLint n_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+    return n_formats > 0;
+}
 
-        if (picked_id % 4 == 1)
-            gizmo->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_ROT
-                                       : RGIZMO_STATE_HOT_ROT;
-        else if (picked_id % 4 == 2)
-            gizmo->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_AXIS
-                                       : RGIZMO_STATE_HOT_AXIS;
-        else if (picked_id % 4 == 3)
-            gizmo->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_PLANE
-                                       : RGIZMO_STATE_HOT_PLANE;
+static unsigned long long get_program_cache_key(void) {
+    const char *strings[5] = {
+        SHADER_VERT,
+        SHADER_FRAG,
+        (const char *)glGetString(GL_VENDOR),
+        (const char *)glGetString(GL_RENDERER),
+        (const char *)glGetString(GL_VERSION)};
+    unsigned long long key = 14695981039346656037ULL;
+    for (int i = 0; i < 5; ++i) {
+        if (strings[i]) key = hash_bytes(key, strings[i], strlen(strings[i]));
     }
+    return key;
+}
 
-    Vector2 delta = GetMouseDelta();
-    bool is_mouse_moved = (fabs(delta.x) + fabs(delta.y)) > EPSILON;
-    if (!is_mouse_moved) return;
+static unsigned int load_program_binary(void) {
+    if (!PROGRAM_CACHE_FILE[0] || !FileExists(PROGRAM_CACHE_FILE)) return 0;
+    if (!has_program_binaries()) return 0;
 
-    switch (gizmo->state) {
-        case RGIZMO_STATE_ACTIVE_ROT: {
-            Vector2 p1 = Vector2Subtract(
-                GetMousePosition(), GetWorldToScreen(position, camera)
-            );
-            Vector2 p0 = Vector2Subtract(p1, GetMouseDelta());
+    int size = 0;
+    unsigned char *data = LoadFileData(PROGRAM_CACHE_FILE, &size);
+    GLuint id = 0;
+    if (data && size > PROGRAM_CACHE_HEADER_SIZE) {
+        unsigned int magic;
+        unsigned long long key;
+        GLenum format;
+        memcpy(&magic, data, 4);
+        memcpy(&key, data + 4, 8);
+        memcpy(&format, data + 12, 4);
 
-            // Get angle between two vectors:
-            float angle = 0.0f;
-            float dot = Vector2DotProduct(
-                Vector2Normalize(p1), Vector2Normalize(p0)
+        if (magic == PROGRAM_CACHE_MAGIC && key == get_program_cache_key()) {
+            GLint is_linked = GL_FALSE;
+            id = glCreateProgram();
+            glProgramBinary(
+                id,
+                format,
+                data + PROGRAM_CACHE_HEADER_SIZE,
+                size - PROGRAM_CACHE_HEADER_SIZE
             );
-            if (1.0 - fabs(dot) > EPSILON) {
-                angle = acos(dot);
-                float z = p1.x * p0.y - p1.y * p0.x;
-
-                if (fabs(z) < EPSILON) angle = 0.0;
-                else if (z <= 0) angle *= -1.0;
+            glGetProgramiv(id, GL_LINK_STATUS, &is_linked);
+            if (!is_linked) {
+                glDeleteProgram(id);
+                id = 0;
             }
+        }
+    }
+    UnloadFileData(data);
 
-            // If we look at the gizmo from behind, we should flip the rotation
-            if (Vector3DotProduct(gizmo->update.axis, position)
-                > Vector3DotProduct(gizmo->update.axis, camera.position)) {
-                angle *= -1;
-            }
+    if (!id) TraceLog(LOG_INFO, "RAYGIZMO: Program cache is stale, rebuild");
+    return id;
+}
 
-            gizmo->update.angle = angle;
-            break;
-        };
-        case RGIZMO_STATE_ACTIVE_AXIS: {
-            Vector2 p = Vector2Add(
-                GetWorldToScreen(position, camera), GetMouseDelta()
-            );
-            Ray r = GetMouseRay(p, camera);
+static void save_program_binary(GLuint id) {
+    if (!PROGRAM_CACHE_FILE[0] || !has_program_binaries()) return;
 
-            // Get two lines nearest point
-            Vector3 line0point0 = camera.position;
-            Vector3 line0point1 = Vector3Add(line0point0, r.direction);
-            Vector3 line1point0 = position;
-            Vector3 line1point1 = Vector3Add(line1point0, gizmo->update.axis);
-            Vector3 vec0 = Vector3Subtract(line0point1, line0point0);
-            Vector3 vec1 = Vector3Subtract(line1point1, line1point0);
-            Vector3 plane_vec = Vector3Normalize(Vector3CrossProduct(vec0, vec1)
-            );
-            Vector3 plane_normal = Vector3Normalize(
-                Vector3CrossProduct(vec0, plane_vec)
-            );
+    GLint length = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
 
-            // Intersect line and plane
-            float dot = Vector3DotProduct(plane_normal, vec1);
-            if (fabs(dot) > EPSILON) {
-                Vector3 w = Vector3Subtract(line1point0, line0point0);
-                float k = -Vector3DotProduct(plane_normal, w) / dot;
-                Vector3 isect = Vector3Add(line1point0, Vector3Scale(vec1, k));
-                gizmo->update.translation = Vector3Subtract(isect, position);
-            }
-            break;
-        }
-        case RGIZMO_STATE_ACTIVE_PLANE: {
-            Vector2 p = Vector2Add(
-                GetWorldToScreen(position, camera), GetMouseDelta()
-            );
-            Ray r = GetMouseRay(p, camera);
+    unsigned char *data = (unsigned char *)malloc(
+        PROGRAM_CACHE_HEADER_SIZE + length
+    );
+    if (!data) return;
 
-            // Collide ray and plane
-            float denominator = r.direction.x * gizmo->update.axis.x
-                                + r.direction.y * gizmo->update.axis.y
-                                + r.direction.z * gizmo->update.axis.z;
+    GLenum format = 0;
+    glGetProgramBinary(
+        id, length, &length, &format, data + PROGRAM_CACHE_HEADER_SIZE
+    );
+    unsigned int magic = PROGRAM_CACHE_MAGIC;
+    unsigned long long key = get_program_cache_key();
+    memcpy(data, &magic, 4);
+    memcpy(data + 4, &key, 8);
+    memcpy(data + 12, &format, 4);
+    if (!SaveFileData(
+            PROGRAM_CACHE_FILE, data, PROGRAM_CACHE_HEADER_SIZE + length
+        )) {
+        TraceLog(LOG_WARNING, "RAYGIZMO: Failed to save the program cache");
+    }
+    free(data);
+}
 
-            if (fabs(denominator) > EPSILON) {
-                float t = ((position.x - r.position.x) * gizmo->update.axis.x
-                           + (position.y - r.position.y) * gizmo->update.axis.y
-                           + (position.z - r.position.z) * gizmo->update.axis.z)
-                          / denominator;
+static GLuint compile_shader(GLenum type, const char *code) {
+    GLint is_compiled = GL_FALSE;
+    GLuint id = glCreateShader(type);
+    glShaderSource(id, 1, &code, NULL);
+    glCompileShader(id);
+    glGetShaderiv(id, GL_COMPILE_STATUS, &is_compiled);
+    if (!is_compiled) {
+        glDeleteShader(id);
+        return 0;
+    }
+    return id;
+}
 
-                if (t > 0) {
-                    Vector3 c = Vector3Add(
-                        r.position, Vector3Scale(r.direction, t)
-                    );
-                    gizmo->update.translation = Vector3Subtract(c, position);
-                }
-            }
-            break;
+// Links the program by hand (rlgl doesn't), so the binary may be asked
+// to be retrievable before the link
+static GLuint link_gizmo_program(void) {
+    GLuint vert = compile_shader(GL_VERTEX_SHADER, SHADER_VERT);
+    GLuint frag = compile_shader(GL_FRAGMENT_SHADER, SHADER_FRAG);
+    GLuint id = 0;
+    if (vert && frag) {
+        GLint is_linked = GL_FALSE;
+        id = glCreateProgram();
+        glAttachShader(id, vert);
+        glAttachShader(id, frag);
+        if (PROGRAM_CACHE_FILE[0] && has_program_binaries()) {
+            glProgramParameteri(
+                id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE
+            );
+        }
+        glLinkProgram(id);
+        glGetProgramiv(id, GL_LINK_STATUS, &is_linked);
+        glDetachShader(id, vert);
+        glDetachShader(id, frag);
+        if (!is_linked) {
+            glDeleteProgram(id);
+            id = 0;
         }
-        default: break;
     }
+    if (vert) glDeleteShader(vert);
+    if (frag) glDeleteShader(frag);
+    return id;
 }
+#endif
 
-void rgizmo_draw(RGizmo gizmo, Camera3D camera, Vector3 position) {
-    if (!IS_LOADED) {
-        TraceLog(LOG_ERROR, "RAYGIZMO: Gizmo is not loaded");
-        exit(1);
+// Returns 0 if the program has failed to compile or link
+static unsigned int load_gizmo_program(void) {
+#if defined(RAYGIZMO_DIRECT_GL)
+    unsigned int id = load_program_binary();
+    if (id) return id;
+
+    id = link_gizmo_program();
+    if (id) save_program_binary(id);
+    return id;
+#else
+    // rlgl falls back to its default shader if the code fails
+    unsigned int id = rlLoadShaderCode(SHADER_VERT, SHADER_FRAG);
+    return id == rlGetShaderIdDefault() ? 0 : id;
+#endif
+}
+
+// The gizmo program and the vertex array of the context, created on the
+// first draw or GPU picking pass
+static bool require_context_shader(RGizmoContext *context) {
+    if (context->shader_id) return true;
+    if (context->is_shader_failed || !require_gizmo_mesh()) return false;
+
+    double start = GetTime();
+    unsigned int id = load_gizmo_program();
+    if (!id) {
+        context->is_shader_failed = true;
+        set_error(RGIZMO_ERROR_SHADER, "Failed to load the gizmo shader");
+        return false;
     }
 
-    HandleColors colors;
-    colors.rot = get_xyz_colors(
-        gizmo.update.axis,
-        gizmo.state == RGIZMO_STATE_HOT_ROT
-            || gizmo.state == RGIZMO_STATE_ACTIVE_ROT
+    context->shader_id = id;
+    context->shader_mvp_loc = rlGetLocationUniform(id, "mvp");
+    context->shader_viewport_size_loc = rlGetLocationUniform(
+        id, "viewportSize"
     );
-    colors.axis = get_xyz_colors(
-        gizmo.update.axis,
-        gizmo.state == RGIZMO_STATE_HOT_AXIS
-            || gizmo.state == RGIZMO_STATE_ACTIVE_AXIS
+    context->shader_camera_position_loc = rlGetLocationUniform(
+        id, "cameraPosition"
     );
-    colors.plane = get_xyz_colors(
-        gizmo.update.axis,
-        gizmo.state == RGIZMO_STATE_HOT_PLANE
-            || gizmo.state == RGIZMO_STATE_ACTIVE_PLANE
+    context->shader_picking_pass_loc = rlGetLocationUniform(
+        id, "pickingPass"
     );
+    set_constant_uniforms(id);
+    load_context_mesh(context);
 
-    draw_gizmo(gizmo, camera, position, colors);
+    TraceLog(
+        LOG_INFO,
+        "RAYGIZMO: Gizmo shader loaded in %.2f ms",
+        1e3 * (GetTime() - start)
+    );
+    return true;
 }
 
-Matrix rgizmo_get_tranform(RGizmo gizmo, Vector3 position) {
-    Matrix translation = MatrixTranslate(
-        gizmo.update.translation.x,
-        gizmo.update.translation.y,
-        gizmo.update.translation.z
+// rlgl applies the line width when the batch is drawn, so the lines of the
+// previous width are flushed first. Returns whether they were
+static bool set_line_width(float width) {
+    if (rlGetLineWidth() == width) return false;
+    rlDrawRenderBatchActive();
+    rlSetLineWidth(width);
+    return true;
+}
+
+static bool has_active_axis(RGizmo gizmo) {
+    return gizmo.state == RGIZMO_STATE_ACTIVE_ROT
+           || gizmo.state == RGIZMO_STATE_ACTIVE_AXIS;
+}
+
+// Long white line which represents the active axis. It goes into the rlgl
+// batch, which EndMode3D flushes with the rest of the gizmo
+static void draw_active_axis(RGizmo gizmo, Vector3 position) {
+    Vector3 halfAxisLine = Vector3Scale(gizmo.update.axis, 1000.0f);
+    DrawLine3D(
+        Vector3Subtract(position, halfAxisLine),
+        Vector3Add(position, halfAxisLine),
+        WHITE
     );
+}
+
+// Draws the handles of all gizmos with one instanced draw call per handle
+// slot: sorted plane handles, rotation handles and sorted axis handles. So
+// the gizmos are interleaved by the handle type (e.g. axis handles of every
+// gizmo are drawn over the plane handles of the other ones), and within one
+// slot the later gizmo is drawn over the earlier one. The slot is a part of
+// the mesh, so the draw calls go one after another with no state changes,
+// and the active axis lines are drawn within the same 3D mode block.
+// In the picking pass the handle ids and the 1-based gizmo indices are
+// drawn instead of the colors. Gizmos are taken by the indices, if given
+static void draw_gizmos(
+    const RGizmo *gizmos,
+    const Vector3 *positions,
+    const int *indices,
+    int count,
+    Camera3D camera,
+    DrawPass pass,
+    bool is_picking
+) {
+    RGizmoContext *context = CONTEXT;
+    if (count <= 0 || !require_context_shader(context)) return;
+    if (!reserve_mesh_instances(count)) return;
 
-    Matrix rotation = MatrixMultiply(
-        MatrixMultiply(
-            MatrixTranslate(-position.x, -position.y, -position.z),
-            MatrixRotate(gizmo.update.axis, gizmo.update.angle)
-        ),
-        MatrixTranslate(position.x, position.y, position.z)
+    // ---------------------------------------------------------------
+    // Upload the instances, the mesh itself is static. All of them share
+    // the finest cone lod among them (in perspective the gizmos have the
+    // same screen size anyway). The picking pass maps the viewport onto
+    // the screen with the pick matrix
+    float height = pass.size.y;
+    if (pass.has_pick_matrix) height *= pass.pick_matrix.m5;
+    int lod = 0;
+    for (int k = 0; k < count; ++k) {
+        int i = indices ? indices[k] : k;
+        int gizmo_lod = get_cone_lod(gizmos[i], camera, positions[i], height);
+        if (gizmo_lod > lod) lod = gizmo_lod;
+        MESH_INSTANCES[k] = get_mesh_instance(
+            gizmos[i],
+            camera,
+            positions[i],
+            is_picking ? -1 : get_hot_handle(gizmos[i]),
+            is_picking ? i + 1 : 0
+        );
+    }
+    rlUpdateVertexBuffer(
+        MESH_INSTANCE_VBO, MESH_INSTANCES, count * sizeof(MeshInstance), 0
     );
 
-    Matrix transform = MatrixMultiply(translation, rotation);
+    begin_gizmo_mode_3d(camera, pass);
+    rlDisableDepthTest();
+    rlDisableBackfaceCulling();
+    add_draw_stats(0, 0, 4);
 
-    return transform;
+    // ---------------------------------------------------------------
+    // Set the per-pass uniforms
+    {
+        float picking_pass = is_picking ? 1.0f : 0.0f;
+        Matrix mvp = MatrixMultiply(
+            rlGetMatrixModelview(), rlGetMatrixProjection()
+        );
+
+        rlEnableShader(context->shader_id);
+        rlSetUniformMatrix(context->shader_mvp_loc, mvp);
+        rlSetUniform(
+            context->shader_viewport_size_loc,
+            &pass.size,
+            RL_SHADER_UNIFORM_VEC2,
+            1
+        );
+        rlSetUniform(
+            context->shader_camera_position_loc,
+            &camera.position,
+            RL_SHADER_UNIFORM_VEC3,
+            1
+        );
+        rlSetUniform(
+            context->shader_picking_pass_loc,
+            &picking_pass,
+            RL_SHADER_UNIFORM_FLOAT,
+            1
+        );
+        bind_gizmo_mesh(context);
+        add_draw_stats(0, 0, 6);
+    }
+
+    // ---------------------------------------------------------------
+    // Draw plane handles, rotation handles and axis handles
+    MeshRange ranges[7] = {
+        MESH_PLANE_RANGES[0],
+        MESH_PLANE_RANGES[1],
+        MESH_PLANE_RANGES[2],
+        MESH_ROT_RANGE,
+        MESH_AXIS_RANGES[lod][0],
+        MESH_AXIS_RANGES[lod][1],
+        MESH_AXIS_RANGES[lod][2]};
+    bool is_instanced = has_instanced_draws();
+    if (!is_instanced) disable_instance_attributes(context);
+    for (int i = 0; i < 7; ++i) {
+        if (is_instanced) {
+            rlDrawVertexArrayInstanced(
+                ranges[i].offset, ranges[i].count, count
+            );
+            add_draw_stats(1, ranges[i].count * count, 0);
+            continue;
+        }
+
+        // The same slot-major order as the instanced draws
+        for (int k = 0; k < count; ++k) {
+            set_instance_attributes(context, &MESH_INSTANCES[k]);
+            rlDrawVertexArray(ranges[i].offset, ranges[i].count);
+        }
+        add_draw_stats(count, ranges[i].count * count, 3 * count);
+    }
+
+    unbind_gizmo_mesh(context);
+    rlDisableShader();
+    rlEnableBackfaceCulling();
+
+    // ---------------------------------------------------------------
+    // Draw active axis lines, a batch per line width
+    float line_width = rlGetLineWidth();
+    int n_lines = 0;
+    int n_batches = 0;
+    for (int k = 0; k < count && !is_picking; ++k) {
+        int i = indices ? indices[k] : k;
+        if (!has_active_axis(gizmos[i])) continue;
+
+        float width = gizmos[i].view.active_axis_draw_thickness;
+        bool is_flushed = set_line_width(width);
+        n_batches += n_lines == 0 || is_flushed;
+        n_lines += 1;
+        draw_active_axis(gizmos[i], positions[i]);
+    }
+    if (n_lines > 0) add_draw_stats(n_batches, 2 * n_lines, n_batches);
+
+    EndMode3D();
+    rlSetLineWidth(line_width);
+    add_draw_stats(0, 0, 4);
+
+    // ---------------------------------------------------------------
+    // Draw white line from the gizmo's center to the mouse cursor when
+    // rotating (into the 2D batch of the caller, it's flushed only if the
+    // line width changes)
+    bool has_rot_lines = false;
+    for (int k = 0; k < count && !is_picking; ++k) {
+        int i = indices ? indices[k] : k;
+        if (gizmos[i].state != RGIZMO_STATE_ACTIVE_ROT) continue;
+
+        Vector2 center = GetWorldToScreenEx(
+            positions[i], camera, (int)pass.size.x, (int)pass.size.y
+        );
+        set_line_width(gizmos[i].view.active_axis_draw_thickness);
+        DrawLineV(center, rgizmo_get_input().mouse_position, WHITE);
+        has_rot_lines = true;
+    }
+    if (has_rot_lines) set_line_width(line_width);
+}
+
+// The same as GetWorldToScreenEx, but with raymath only (no raylib state),
+// so the solve stage is safe to run on any thread
+static Vector2 get_world_to_screen(
+    Vector3 point, Camera3D camera, RGizmoInput input
+) {
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = get_camera_projection(camera, input);
+    Quaternion p = {point.x, point.y, point.z, 1.0f};
+    p = QuaternionTransform(QuaternionTransform(p, view), projection);
+
+    Vector2 screen = {
+        (p.x / p.w + 1.0f) / 2.0f * (float)input.screen_width,
+        (-p.y / p.w + 1.0f) / 2.0f * (float)input.screen_height};
+    return screen;
+}
+
+// The same as GetMouseRay, but for the screen size of the input
+static Ray get_screen_ray(Vector2 point, Camera3D camera, RGizmoInput input) {
+    float width = (float)input.screen_width;
+    float height = (float)input.screen_height;
+    float x = 2.0f * point.x / width - 1.0f;
+    float y = 1.0f - 2.0f * point.y / height;
+
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = get_camera_projection(camera, input);
+
+    Vector3 near = Vector3Unproject((Vector3){x, y, 0.0f}, projection, view);
+    Vector3 far = Vector3Unproject((Vector3){x, y, 1.0f}, projection, view);
+    Ray ray;
+    ray.direction = Vector3Normalize(Vector3Subtract(far, near));
+    ray.position = camera.position;
+    if (camera.projection == CAMERA_ORTHOGRAPHIC) {
+        ray.position = Vector3Unproject(
+            (Vector3){x, y, -1.0f}, projection, view
+        );
+    }
+    return ray;
+}
+
+static bool is_behind_camera(Vector3 point, Camera3D camera) {
+    if (camera.projection != CAMERA_PERSPECTIVE) return false;
+    Vector3 forward = Vector3Subtract(camera.target, camera.position);
+    Vector3 dir = Vector3Subtract(point, camera.position);
+    return Vector3DotProduct(dir, forward) <= 0.0f;
+}
+
+// Screen-space distance from the mouse cursor to the projected segment. The
+// closest point parameter along the segment is written into t
+static float get_segment_screen_dist(
+    RGizmoInput input, Vector3 start, Vector3 end, Camera3D camera, float *t
+) {
+    Vector2 point = input.mouse_position;
+    *t = 0.0f;
+    if (is_behind_camera(start, camera) || is_behind_camera(end, camera)) {
+        return FLT_MAX;
+    }
+
+    Vector2 a = get_world_to_screen(start, camera, input);
+    Vector2 b = get_world_to_screen(end, camera, input);
+    Vector2 ab = Vector2Subtract(b, a);
+    float len_sqr = Vector2DotProduct(ab, ab);
+    if (len_sqr > EPSILON) {
+        float k = Vector2DotProduct(Vector2Subtract(point, a), ab) / len_sqr;
+        *t = Clamp(k, 0.0f, 1.0f);
+    }
+
+    return Vector2Distance(point, Vector2Add(a, Vector2Scale(ab, *t)));
+}
+
+static bool check_collision_ray_quad(
+    Ray ray, Vector3 center, Vector3 normal, float half_size
+) {
+    float denominator = Vector3DotProduct(ray.direction, normal);
+    if (fabs(denominator) < EPSILON) return false;
+
+    Vector3 w = Vector3Subtract(center, ray.position);
+    float t = Vector3DotProduct(w, normal) / denominator;
+    if (t < 0.0f) return false;
+
+    // Plane handles are axis aligned, so the in-plane extents are just the
+    // per-component distances to the center
+    Vector3 d = Vector3Subtract(
+        Vector3Add(ray.position, Vector3Scale(ray.direction, t)), center
+    );
+    return fabs(d.x) <= half_size && fabs(d.y) <= half_size
+           && fabs(d.z) <= half_size;
+}
+
+static bool check_collision_ray_cone(
+    Ray ray, Vector3 base, Vector3 apex, float radius
+) {
+    Vector3 axis = Vector3Subtract(base, apex);
+    float height = Vector3Length(axis);
+    if (height < EPSILON) return false;
+    axis = Vector3Scale(axis, 1.0f / height);
+
+    // Side surface: points p with dot(p - apex, axis) = |p - apex| * cos
+    float cos_sqr = (height * height) / (height * height + radius * radius);
+    Vector3 co = Vector3Subtract(ray.position, apex);
+    float dir_dot = Vector3DotProduct(ray.direction, axis);
+    float co_dot = Vector3DotProduct(co, axis);
+    float a = dir_dot * dir_dot - cos_sqr;
+    float b = 2.0f
+              * (dir_dot * co_dot
+                 - cos_sqr * Vector3DotProduct(ray.direction, co));
+    float c = co_dot * co_dot - cos_sqr * Vector3DotProduct(co, co);
+
+    float roots[2];
+    int n_roots = 0;
+    if (fabs(a) < EPSILON) {
+        if (fabs(b) > EPSILON) roots[n_roots++] = -c / b;
+    } else {
+        float discriminant = b * b - 4.0f * a * c;
+        if (discriminant >= 0.0f) {
+            float sqrt_discriminant = sqrtf(discriminant);
+            roots[n_roots++] = (-b - sqrt_discriminant) / (2.0f * a);
+            roots[n_roots++] = (-b + sqrt_discriminant) / (2.0f * a);
+        }
+    }
+
+    for (int i = 0; i < n_roots; ++i) {
+        if (roots[i] < 0.0f) continue;
+        float h = co_dot + roots[i] * dir_dot;
+        if (h >= 0.0f && h <= height) return true;
+    }
+
+    // Base cap
+    if (fabs(dir_dot) > EPSILON) {
+        float t = Vector3DotProduct(Vector3Subtract(base, ray.position), axis)
+                  / dir_dot;
+        Vector3 p = Vector3Add(ray.position, Vector3Scale(ray.direction, t));
+        if (t >= 0.0f && Vector3Distance(p, base) <= radius) return true;
+    }
+
+    return false;
+}
+
+// Tests the handles in the same order draw_gizmo draws them, so the last
+// hit handle wins exactly as it does in the picking fbo
+static unsigned char pick_gizmo_cpu(
+    RGizmo gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    float radius = get_gizmo_radius(gizmo, camera, position);
+    float half_thickness = 0.5f * gizmo.view.handle_draw_thickness;
+    Ray ray = get_screen_ray(input.mouse_position, camera, input);
+    unsigned char picked_id = 0;
+    float t;
+
+    // ---------------------------------------------------------------
+    // Pick plane handles
+    {
+        float half_size = 0.5f * radius * gizmo.view.plane_handle_size;
+        Handles handles = get_plane_handles(
+            gizmo, camera, position, PICKING_COLORS.plane
+        );
+
+        for (int i = 0; i < 3; ++i) {
+            Handle *h = &handles.arr[i];
+            Vector3 normal = Vector3RotateByAxisAngle(
+                Y_AXIS, h->axis, 0.5f * PI
+            );
+            if (check_collision_ray_quad(ray, h->position, normal, half_size)) {
+                picked_id = h->color.r;
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Pick rotation handles (segments of the ring the shader draws)
+    {
+        Vector3 u[3] = {Vector3Negate(Z_AXIS), X_AXIS, X_AXIS};
+        Vector3 v[3] = {Y_AXIS, Z_AXIS, Y_AXIS};
+        Color ids[3] = {
+            PICKING_COLORS.rot.x, PICKING_COLORS.rot.y, PICKING_COLORS.rot.z};
+
+        for (int i = 0; i < 3; ++i) {
+            for (int k = 0; k < PICK_RING_SEGMENTS; ++k) {
+                float a0 = 2.0f * PI * k / PICK_RING_SEGMENTS;
+                float a1 = 2.0f * PI * (k + 1) / PICK_RING_SEGMENTS;
+                Vector3 p0 = Vector3Add(
+                    position,
+                    Vector3Add(
+                        Vector3Scale(u[i], radius * sinf(a0)),
+                        Vector3Scale(v[i], radius * cosf(a0))
+                    )
+                );
+                Vector3 p1 = Vector3Add(
+                    position,
+                    Vector3Add(
+                        Vector3Scale(u[i], radius * sinf(a1)),
+                        Vector3Scale(v[i], radius * cosf(a1))
+                    )
+                );
+
+                float dist = get_segment_screen_dist(
+                    input, p0, p1, camera, &t
+                );
+                if (dist > half_thickness) continue;
+
+                // The same back half discard as SHADER_FRAG does
+                Vector3 p = Vector3Lerp(p0, p1, t);
+                Vector3 r = Vector3Normalize(Vector3Subtract(p, position));
+                Vector3 c = Vector3Normalize(
+                    Vector3Subtract(p, camera.position)
+                );
+                if (Vector3DotProduct(r, c) > 0.1f) continue;
+
+                picked_id = ids[i].r;
+                break;
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Pick axis handles
+    {
+        float tip_length = radius * gizmo.view.axis_handle_tip_length;
+        float tip_radius = radius * gizmo.view.axis_handle_tip_radius;
+        Handles handles = get_axis_handles(
+            gizmo, camera, position, PICKING_COLORS.axis
+        );
+
+        for (int i = 0; i < 3; ++i) {
+            Handle *h = &handles.arr[i];
+            Vector3 tip_end = Vector3Add(
+                h->position, Vector3Scale(h->axis, tip_length)
+            );
+            float dist = get_segment_screen_dist(
+                input, position, h->position, camera, &t
+            );
+            if (dist <= half_thickness
+                || check_collision_ray_cone(
+                    ray, h->position, tip_end, tip_radius
+                )) {
+                picked_id = h->color.r;
+            }
+        }
+    }
+
+    return picked_id;
+}
+
+// Maps the PICKING_REGION_SIZE screen pixels around the mouse cursor onto
+// the whole clip space, like gluPickMatrix does. Applied on top of the
+// camera projection, so the region is rasterized at the native resolution
+static Matrix get_pick_matrix(RGizmoInput input) {
+    float width = (float)input.screen_width;
+    float height = (float)input.screen_height;
+    float sx = width / PICKING_REGION_SIZE;
+    float sy = height / PICKING_REGION_SIZE;
+    float cx = 2.0f * floorf(input.mouse_position.x) / width - 1.0f;
+    float cy = 1.0f - 2.0f * floorf(input.mouse_position.y) / height;
+
+    Matrix pick = MatrixIdentity();
+    pick.m0 = sx;
+    pick.m5 = sy;
+    pick.m12 = -cx * sx;
+    pick.m13 = -cy * sy;
+    return pick;
+}
+
+// Returns 0 if the fbo can't be created
+static unsigned int load_picking_fbo(
+    int width, int height, unsigned int *texture
+) {
+    unsigned int fbo = rlLoadFramebuffer(width, height);
+    if (!fbo) {
+        set_error(RGIZMO_ERROR_FRAMEBUFFER, "Failed to create picking fbo");
+        return 0;
+    }
+    rlEnableFramebuffer(fbo);
+
+    *texture = rlLoadTexture(
+        NULL, width, height, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1
+    );
+    rlActiveDrawBuffers(1);
+    rlFramebufferAttach(
+        fbo,
+        *texture,
+        RL_ATTACHMENT_COLOR_CHANNEL0,
+        RL_ATTACHMENT_TEXTURE2D,
+        0
+    );
+
+    // The scene ids are depth tested (rlUnloadFramebuffer deletes it)
+    unsigned int depth = rlLoadTextureDepth(width, height, true);
+    rlFramebufferAttach(
+        fbo, depth, RL_ATTACHMENT_DEPTH, RL_ATTACHMENT_RENDERBUFFER, 0
+    );
+    bool is_complete = rlFramebufferComplete(fbo);
+    rlDisableFramebuffer();
+    if (!is_complete) {
+        set_error(RGIZMO_ERROR_FRAMEBUFFER, "Picking fbo is not complete");
+        rlUnloadFramebuffer(fbo);
+        rlUnloadTexture(*texture);
+        *texture = 0;
+        return 0;
+    }
+
+    return fbo;
+}
+
+// (Re)creates the picking fbo of the context if its size differs, so it's
+// reallocated only when the viewport is resized
+static bool resize_picking_fbo(RGizmoContext *context, int width, int height) {
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    if (context->picking_fbo && context->picking_width == width
+        && context->picking_height == height) {
+        return true;
+    }
+
+    if (context->picking_fbo) {
+        rlUnloadFramebuffer(context->picking_fbo);
+        rlUnloadTexture(context->picking_texture);
+    }
+    context->picking_fbo = load_picking_fbo(
+        width, height, &context->picking_texture
+    );
+    context->picking_width = width;
+    context->picking_height = height;
+    return context->picking_fbo != 0;
+}
+
+static bool require_scene_shader(RGizmoContext *context) {
+    if (context->scene_shader.id) return true;
+
+    Shader shader = LoadShaderFromMemory(SCENE_SHADER_VERT, SCENE_SHADER_FRAG);
+    if (shader.id == rlGetShaderIdDefault()) {
+        set_error(RGIZMO_ERROR_SHADER, "Failed to load the scene id shader");
+        return false;
+    }
+    context->scene_shader = shader;
+    context->scene_shader_id_loc = GetShaderLocation(shader, "sceneId");
+    return true;
+}
+
+#if defined(RAYGIZMO_DIRECT_GL)
+static bool grow_picking_pbos(RGizmoContext *context, int count);
+#endif
+
+// Everything the GPU picking pass of the mode needs: the gizmo shader, the
+// picking target (the whole viewport or the region around the cursor) and
+// the scene id shader if the scene ids are drawn. If anything fails, the
+// context picks on the CPU from then on
+static bool require_picking(
+    RGizmoContext *context,
+    RGizmoInput input,
+    RGizmoPickMode mode,
+    bool cursor_frustum,
+    bool has_scene
+) {
+    if (context->is_picking_failed) return false;
+    bool is_ok = require_context_shader(context);
+    if (is_ok && cursor_frustum && !context->picking_region_fbo) {
+        context->picking_region_fbo = load_picking_fbo(
+            PICKING_REGION_SIZE,
+            PICKING_REGION_SIZE,
+            &context->picking_region_texture
+        );
+        is_ok = context->picking_region_fbo != 0;
+    } else if (is_ok && !cursor_frustum) {
+        is_ok = resize_picking_fbo(
+            context, input.screen_width, input.screen_height
+        );
+    }
+    if (is_ok && has_scene) is_ok = require_scene_shader(context);
+#if defined(RAYGIZMO_DIRECT_GL)
+    if (is_ok && mode == RGIZMO_PICK_GPU_ASYNC && !context->n_picking_pbos) {
+        is_ok = grow_picking_pbos(context, PICKING_PBO_COUNT);
+    }
+#else
+    (void)mode;
+#endif
+
+    if (!is_ok) {
+        context->is_picking_failed = true;
+        TraceLog(LOG_WARNING, "RAYGIZMO: Fall back to the CPU picking");
+    }
+    return is_ok;
+}
+
+// Viewport of the caller, which the picking pass restores. rlgl doesn't
+// expose it, so without the direct GL calls it's taken to be the whole
+// current framebuffer
+static int PICKING_PREV_VIEWPORT[4];
+
+// Binds and clears the picking fbo. Returns the pass the gizmos must be
+// drawn with: the projection is the one of the input screen, the pick
+// matrix is set only if the region around the cursor is drawn
+static DrawPass begin_picking_pass(
+    RGizmoInput input, bool cursor_frustum
+) {
+    STATS_PICK_START = GetTime();
+    begin_gpu_timer(RGIZMO_PHASE_PICK_RENDER);
+
+#if defined(RAYGIZMO_DIRECT_GL)
+    glGetIntegerv(GL_VIEWPORT, PICKING_PREV_VIEWPORT);
+#else
+    PICKING_PREV_VIEWPORT[0] = 0;
+    PICKING_PREV_VIEWPORT[1] = 0;
+    PICKING_PREV_VIEWPORT[2] = rlGetFramebufferWidth();
+    PICKING_PREV_VIEWPORT[3] = rlGetFramebufferHeight();
+#endif
+
+    RGizmoContext *context = CONTEXT;
+    if (cursor_frustum) {
+        rlEnableFramebuffer(context->picking_region_fbo);
+        rlViewport(0, 0, PICKING_REGION_SIZE, PICKING_REGION_SIZE);
+    } else {
+        rlEnableFramebuffer(context->picking_fbo);
+        rlViewport(0, 0, context->picking_width, context->picking_height);
+    }
+    rlClearColor(0, 0, 0, 0);
+    rlClearScreenBuffers();
+    rlDisableColorBlend();
+
+    DrawPass pass = {
+        {(float)context->picking_width, (float)context->picking_height},
+        true,
+        input,
+        false,
+        MatrixIdentity()};
+    if (cursor_frustum) {
+        pass.size = (Vector2){PICKING_REGION_SIZE, PICKING_REGION_SIZE};
+        pass.has_pick_matrix = true;
+        pass.pick_matrix = get_pick_matrix(input);
+    }
+    return pass;
+}
+
+static void end_picking_pass(void) {
+    rlDisableFramebuffer();
+    rlEnableColorBlend();
+    rlViewport(
+        PICKING_PREV_VIEWPORT[0],
+        PICKING_PREV_VIEWPORT[1],
+        PICKING_PREV_VIEWPORT[2],
+        PICKING_PREV_VIEWPORT[3]
+    );
+
+    end_gpu_timer(RGIZMO_PHASE_PICK_RENDER);
+    end_phase(RGIZMO_PHASE_PICK_RENDER, STATS_PICK_START);
+}
+
+// The picking fbo has the screen size of the input, so the mouse pixel maps
+// onto it directly (flipped vertically)
+static void get_picking_pixel(RGizmoInput input, int *x, int *y) {
+    const RGizmoContext *context = CONTEXT;
+    *x = (int)Clamp(
+        floorf(input.mouse_position.x), 0.0f, context->picking_width - 1
+    );
+    *y = context->picking_height - 1
+         - (int)Clamp(
+             floorf(input.mouse_position.y), 0.0f, context->picking_height - 1
+         );
+}
+
+static unsigned int unpack_picking_pixel(const unsigned char *pixel) {
+    return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16)
+           | ((unsigned int)pixel[3] << 24);
+}
+
+// Returns the picking value of the region texel under the mouse cursor. If
+// it has no handle, the nearest handle within the hover radius wins
+static unsigned int resolve_region_pixels(
+    const unsigned char *pixels, int hover_radius
+) {
+    int cx = PICKING_REGION_SIZE / 2;
+    int cy = PICKING_REGION_SIZE / 2 - 1;
+    unsigned int picked = unpack_picking_pixel(
+        &pixels[4 * (cy * PICKING_REGION_SIZE + cx)]
+    );
+    if ((picked & 0xFF) || hover_radius <= 0) return picked;
+
+    int min_dist_sqr = hover_radius * hover_radius + 1;
+    for (int y = 0; y < PICKING_REGION_SIZE; ++y) {
+        for (int x = 0; x < PICKING_REGION_SIZE; ++x) {
+            int idx = 4 * (y * PICKING_REGION_SIZE + x);
+            const unsigned char *pixel = &pixels[idx];
+            int dist_sqr = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+            if (pixel[0] && dist_sqr < min_dist_sqr) {
+                min_dist_sqr = dist_sqr;
+                picked = unpack_picking_pixel(pixel);
+            }
+        }
+    }
+
+    return picked;
+}
+
+// Synchronously reads back the picking value under the mouse cursor. The
+// handle id is in the lowest byte, the 1-based gizmo index in the next two.
+// If the handle id is 0, the upper 24 bits are the scene id
+static unsigned int read_picking_pixels(
+    RGizmoInput input, bool cursor_frustum, int hover_radius
+) {
+    double start = GetTime();
+    const RGizmoContext *context = CONTEXT;
+    unsigned int picked;
+    if (cursor_frustum) {
+        unsigned char *pixels = (unsigned char *)rlReadTexturePixels(
+            context->picking_region_texture,
+            PICKING_REGION_SIZE,
+            PICKING_REGION_SIZE,
+            RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+        );
+        picked = resolve_region_pixels(pixels, hover_radius);
+        free(pixels);
+    } else {
+        unsigned char *pixels = (unsigned char *)rlReadTexturePixels(
+            context->picking_texture,
+            context->picking_width,
+            context->picking_height,
+            RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+        );
+        int x, y;
+        get_picking_pixel(input, &x, &y);
+        int idx = 4 * (y * context->picking_width + x);
+        picked = unpack_picking_pixel(&pixels[idx]);
+        free(pixels);
+    }
+
+    end_phase(RGIZMO_PHASE_PICK_READBACK, start);
+    return picked;
+}
+
+static bool has_scene_ids(const RGizmo *gizmo) {
+    return gizmo->picking.draw_scene_ids
+           && gizmo->picking.mode != RGIZMO_PICK_CPU;
+}
+
+// Draws the scene ids of the gizmo hook into the picking pass, under the
+// gizmos which are drawn after them with no depth testing
+static void draw_scene_ids(RGizmo gizmo, Camera3D camera, DrawPass pass) {
+    if (!has_scene_ids(&gizmo)) return;
+
+    begin_gizmo_mode_3d(camera, pass);
+    rgizmo_set_scene_id(0);
+    gizmo.picking.draw_scene_ids(
+        CONTEXT->scene_shader, gizmo.picking.scene_user_data
+    );
+    EndMode3D();
+}
+
+#if defined(RAYGIZMO_DIRECT_GL)
+// Picked value of the last update, as the picking pass would give it
+static unsigned int get_picked_value(const RGizmo *gizmo) {
+    if (gizmo->picking.picked_id) return gizmo->picking.picked_id | (1 << 8);
+    return gizmo->picking.picked_scene_id << 8;
+}
+#endif
+
+// Keeps the scene id of the picked value and returns its handle id
+static unsigned char set_picked_value(RGizmo *gizmo, unsigned int picked) {
+    gizmo->picking.picked_scene_id = picked & 0xFF ? 0 : picked >> 8;
+    return (unsigned char)(picked & 0xFF);
+}
+
+static void draw_picking_fbo(
+    RGizmo gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    DrawPass pass = begin_picking_pass(
+        input, gizmo.picking.cursor_frustum
+    );
+    draw_scene_ids(gizmo, camera, pass);
+    draw_gizmos(&gizmo, &position, NULL, 1, camera, pass, true);
+    end_picking_pass();
+}
+
+static unsigned int pick_gizmo_gpu(
+    RGizmo gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    // -------------------------------------------------------------------
+    // Draw gizmo into the picking fbo for the mouse pixel-picking
+    draw_picking_fbo(gizmo, camera, position, input);
+
+    // -------------------------------------------------------------------
+    // Pick the pixel under the mouse cursor
+    return read_picking_pixels(
+        input,
+        gizmo.picking.cursor_frustum,
+        gizmo.picking.hover_radius
+    );
+}
+
+#if defined(RAYGIZMO_DIRECT_GL)
+// Adds the pixel buffers to the ring of the context
+static bool grow_picking_pbos(RGizmoContext *context, int count) {
+    int n = context->n_picking_pbos;
+    PickingPbo *pbos = (PickingPbo *)realloc(
+        context->picking_pbos, (n + count) * sizeof(PickingPbo)
+    );
+    if (!pbos) {
+        set_error(RGIZMO_ERROR_OUT_OF_MEMORY, "Failed to allocate pbos");
+        return false;
+    }
+
+    int size = 4 * PICKING_REGION_SIZE * PICKING_REGION_SIZE;
+    for (int i = n; i < n + count; ++i) {
+        PickingPbo empty = {0};
+        pbos[i] = empty;
+        glGenBuffers(1, &pbos[i].id);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i].id);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    context->picking_pbos = pbos;
+    context->n_picking_pbos = n + count;
+    return true;
+}
+
+static void unload_picking_pbos(RGizmoContext *context) {
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        PickingPbo *pbo = &context->picking_pbos[i];
+        if (pbo->fence) glDeleteSync(pbo->fence);
+        glDeleteBuffers(1, &pbo->id);
+    }
+    free(context->picking_pbos);
+    context->picking_pbos = NULL;
+    context->n_picking_pbos = 0;
+}
+
+static void free_picking_pbo(PickingPbo *pbo) {
+    glDeleteSync(pbo->fence);
+    pbo->fence = NULL;
+    pbo->owner = NULL;
+}
+
+// A readback is stale once twice the ring size readbacks have been queued
+// after it, which the live owners never let happen: its owner has stopped
+// updating, has switched the mode or was destroyed, copied or moved
+static bool is_picking_pbo_stale(
+    const RGizmoContext *context, const PickingPbo *pbo
+) {
+    unsigned int age = context->picking_frame - pbo->frame;
+    return age >= 2 * (unsigned int)context->n_picking_pbos;
+}
+
+// Consumes the newest finished readback of the owner (older ones are
+// dropped) and gives its pick key, if key is not NULL. Never waits for the
+// GPU: returns false if nothing has finished
+static bool consume_picking_pbos(
+    const void *owner,
+    int hover_radius,
+    unsigned int *picked,
+    unsigned long long *key
+) {
+    RGizmoContext *context = CONTEXT;
+    PickingPbo *pbos = context->picking_pbos;
+    PickingPbo *newest = NULL;
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        PickingPbo *pbo = &pbos[i];
+        if (pbo->owner != owner || !pbo->fence) continue;
+
+        GLenum status = glClientWaitSync(pbo->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        if (!newest || pbo->frame > newest->frame) newest = pbo;
+    }
+    if (!newest) return false;
+
+    double start = GetTime();
+    *picked = 0;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->id);
+    unsigned char *pixels = (unsigned char *)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, newest->size, GL_MAP_READ_BIT
+    );
+    if (pixels) {
+        if (newest->size == 4) *picked = unpack_picking_pixel(pixels);
+        else *picked = resolve_region_pixels(pixels, hover_radius);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (key) *key = newest->key;
+
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        PickingPbo *pbo = &pbos[i];
+        if (pbo->owner != owner || pbo->frame > newest->frame) continue;
+        free_picking_pbo(pbo);
+    }
+
+    end_phase(RGIZMO_PHASE_PICK_READBACK, start);
+    return true;
+}
+
+// Pixel buffer for the next readback of the owner. The stale readbacks of
+// any owner are freed first. If all buffers are in flight, the ring grows
+// up to PICKING_MAX_PBOS, and past it the oldest readback of another owner
+// is dropped. NULL if there is still none
+static PickingPbo *get_free_picking_pbo(const void *owner) {
+    RGizmoContext *context = CONTEXT;
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        PickingPbo *pbo = &context->picking_pbos[i];
+        if (pbo->fence && is_picking_pbo_stale(context, pbo)) {
+            free_picking_pbo(pbo);
+        }
+    }
+
+    PickingPbo *oldest = NULL;
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        PickingPbo *pbo = &context->picking_pbos[i];
+        if (!pbo->fence) return pbo;
+        if (pbo->owner != owner && (!oldest || pbo->frame < oldest->frame)) {
+            oldest = pbo;
+        }
+    }
+
+    int n = context->n_picking_pbos;
+    if (n < PICKING_MAX_PBOS) {
+        int count = n > 0 ? n : PICKING_PBO_COUNT;
+        if (count > PICKING_MAX_PBOS - n) count = PICKING_MAX_PBOS - n;
+        if (grow_picking_pbos(context, count)) return &context->picking_pbos[n];
+    }
+    if (oldest) free_picking_pbo(oldest);
+    return oldest;
+}
+
+// Queues the readback of the current mouse pixel (or the whole cursor
+// region) of the picking pass which has just been drawn
+static void queue_picking_pbo(
+    PickingPbo *pbo,
+    const void *owner,
+    unsigned long long key,
+    RGizmoInput input,
+    bool cursor_frustum
+) {
+    RGizmoContext *context = CONTEXT;
+    double start = GetTime();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo->id);
+    if (cursor_frustum) {
+        int size = PICKING_REGION_SIZE;
+        rlEnableFramebuffer(context->picking_region_fbo);
+        glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        pbo->size = 4 * size * size;
+    } else {
+        int x, y;
+        get_picking_pixel(input, &x, &y);
+        rlEnableFramebuffer(context->picking_fbo);
+        glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        pbo->size = 4;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    rlDisableFramebuffer();
+
+    pbo->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pbo->owner = owner;
+    pbo->frame = context->picking_frame++;
+    pbo->key = key;
+    end_phase(RGIZMO_PHASE_PICK_READBACK, start);
+}
+
+// The picked value of the newest finished readback (of the last update if
+// there is none). has_readback tells if the readback of the pick key has
+// been consumed or queued, only then the pick may be cached
+static unsigned int pick_gizmo_gpu_async(
+    const RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    unsigned long long key,
+    bool *has_readback
+) {
+    unsigned int picked = get_picked_value(gizmo);
+    unsigned long long picked_key;
+    *has_readback = consume_picking_pbos(
+                        gizmo, gizmo->picking.hover_radius, &picked, &picked_key
+                    )
+                    && picked_key == key;
+
+    PickingPbo *pbo = get_free_picking_pbo(gizmo);
+    if (pbo) {
+        draw_picking_fbo(*gizmo, camera, position, input);
+        queue_picking_pbo(
+            pbo, gizmo, key, input, gizmo->picking.cursor_frustum
+        );
+        *has_readback = true;
+    }
+    return picked;
+}
+#endif
+
+// Digest of everything the picking result depends on
+static unsigned long long get_pick_key(
+    const RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input
+) {
+    int screen_size[2] = {input.screen_width, input.screen_height};
+    bool is_active = gizmo->state >= RGIZMO_STATE_ACTIVE;
+    unsigned long long key = 14695981039346656037ULL;
+    key = hash_bytes(key, &camera.position, sizeof(camera.position));
+    key = hash_bytes(key, &camera.target, sizeof(camera.target));
+    key = hash_bytes(key, &camera.up, sizeof(camera.up));
+    key = hash_bytes(key, &camera.fovy, sizeof(camera.fovy));
+    key = hash_bytes(key, &camera.projection, sizeof(camera.projection));
+    key = hash_bytes(key, &position, sizeof(position));
+    key = hash_bytes(
+        key, &input.mouse_position, sizeof(input.mouse_position)
+    );
+    key = hash_bytes(key, screen_size, sizeof(screen_size));
+    key = hash_bytes(key, &gizmo->view, sizeof(gizmo->view));
+    key = hash_bytes(key, &is_active, sizeof(is_active));
+    key = hash_bytes(
+        key, &gizmo->picking.mode, sizeof(gizmo->picking.mode)
+    );
+    key = hash_bytes(
+        key,
+        &gizmo->picking.cursor_frustum,
+        sizeof(gizmo->picking.cursor_frustum)
+    );
+    key = hash_bytes(
+        key, &gizmo->picking.hover_radius, sizeof(gizmo->picking.hover_radius)
+    );
+    key = hash_bytes(
+        key,
+        &gizmo->picking.draw_scene_ids,
+        sizeof(gizmo->picking.draw_scene_ids)
+    );
+    return key;
+}
+
+// Radius of the sphere around the gizmo position which contains all the
+// handles geometry
+static float get_gizmo_bounding_radius(
+    RGizmo gizmo, Camera3D camera, Vector3 position
+) {
+    // The axis tip is a cone: its end, or the rim of its base
+    float ring = 1.0f;
+    float axis = fmaxf(
+        gizmo.view.axis_handle_length + gizmo.view.axis_handle_tip_length,
+        hypotf(gizmo.view.axis_handle_length, gizmo.view.axis_handle_tip_radius)
+    );
+    float plane = (gizmo.view.plane_handle_offset
+                   + 0.5f * gizmo.view.plane_handle_size)
+                  * sqrtf(2.0f);
+    float radius = fmaxf(ring, fmaxf(axis, plane));
+    return radius * get_gizmo_radius(gizmo, camera, position);
+}
+
+// Conservative screen rectangle of the gizmo: the projected corners of the
+// box around its bounding sphere, plus the handles line thickness, clipped
+// to the screen (the viewport), so nothing is picked through its edges. If
+// the box crosses the camera plane, the whole screen is returned
+static Rectangle get_screen_bounds(
+    RGizmo gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    Rectangle screen = {
+        0.0f, 0.0f, (float)input.screen_width, (float)input.screen_height};
+    float radius = get_gizmo_bounding_radius(gizmo, camera, position);
+    Vector2 min = {FLT_MAX, FLT_MAX};
+    Vector2 max = {-FLT_MAX, -FLT_MAX};
+
+    for (int i = 0; i < 8; ++i) {
+        Vector3 corner = {
+            position.x + (i & 1 ? radius : -radius),
+            position.y + (i & 2 ? radius : -radius),
+            position.z + (i & 4 ? radius : -radius)};
+        if (is_behind_camera(corner, camera)) return screen;
+
+        Vector2 p = get_world_to_screen(corner, camera, input);
+        min = (Vector2){fminf(min.x, p.x), fminf(min.y, p.y)};
+        max = (Vector2){fmaxf(max.x, p.x), fmaxf(max.y, p.y)};
+    }
+
+    float margin = 0.5f * gizmo.view.handle_draw_thickness
+                   + (float)gizmo.picking.hover_radius + 1.0f;
+    Rectangle bounds = {
+        min.x - margin,
+        min.y - margin,
+        max.x - min.x + 2.0f * margin,
+        max.y - min.y + 2.0f * margin};
+    return GetCollisionRec(bounds, screen);
+}
+
+static unsigned char pick_gizmo(
+    RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input
+) {
+    // -------------------------------------------------------------------
+    // Nothing can be picked if the mouse cursor is outside of the gizmo
+    // screen bounds (unless there are scene ids to pick)
+    if (gizmo->state < RGIZMO_STATE_ACTIVE && !has_scene_ids(gizmo)) {
+        Rectangle bounds = get_screen_bounds(
+            *gizmo, camera, position, input
+        );
+        if (!CheckCollisionPointRec(input.mouse_position, bounds)) {
+            gizmo->picking.cache.is_valid = false;
+            gizmo->picking.cache.n_culls += 1;
+            gizmo->picking.picked_scene_id = 0;
+#if defined(RAYGIZMO_DIRECT_GL)
+            // Drop the readbacks which are still in flight
+            if (gizmo->picking.mode == RGIZMO_PICK_GPU_ASYNC) {
+                unsigned int picked;
+                consume_picking_pbos(gizmo, 0, &picked, NULL);
+            }
+#endif
+            return 0;
+        }
+    }
+
+    // -------------------------------------------------------------------
+    // Reuse the last picked id if the picking inputs didn't change, or if
+    // a handle is being dragged (the picked id is not used then anyway)
+    unsigned long long key = get_pick_key(
+        gizmo, camera, position, input
+    );
+    bool is_dragging = input.is_lmb_down
+                       && gizmo->state >= RGIZMO_STATE_ACTIVE;
+    bool is_hit = is_dragging
+                  || (gizmo->picking.cache.is_valid
+                      && gizmo->picking.cache.key == key);
+    gizmo->picking.cache.key = key;
+    gizmo->picking.cache.is_valid = !is_dragging;
+
+    if (is_hit) {
+        gizmo->picking.cache.n_hits += 1;
+#if defined(RAYGIZMO_DIRECT_GL)
+        // Readbacks which are still in flight must be delivered anyway
+        if (gizmo->picking.mode == RGIZMO_PICK_GPU_ASYNC) {
+            unsigned int picked = get_picked_value(gizmo);
+            consume_picking_pbos(
+                gizmo, gizmo->picking.hover_radius, &picked, NULL
+            );
+            return set_picked_value(gizmo, picked);
+        }
+#endif
+        return gizmo->picking.picked_id;
+    }
+    gizmo->picking.cache.n_misses += 1;
+
+    // -------------------------------------------------------------------
+    // Pick the handle under the mouse cursor
+    RGizmoPickMode mode = gizmo->picking.mode;
+    if (mode != RGIZMO_PICK_CPU
+        && !require_picking(
+            CONTEXT,
+            input,
+            mode,
+            gizmo->picking.cursor_frustum,
+            has_scene_ids(gizmo)
+        )) {
+        mode = RGIZMO_PICK_CPU;
+    }
+    switch (mode) {
+        case RGIZMO_PICK_CPU:
+            gizmo->picking.picked_scene_id = 0;
+            return pick_gizmo_cpu(*gizmo, camera, position, input);
+#if defined(RAYGIZMO_DIRECT_GL)
+        case RGIZMO_PICK_GPU_ASYNC: {
+            bool has_readback;
+            unsigned int picked = pick_gizmo_gpu_async(
+                gizmo, camera, position, input, key, &has_readback
+            );
+            gizmo->picking.cache.is_valid = has_readback;
+            return set_picked_value(gizmo, picked);
+        }
+#endif
+        default:
+            return set_picked_value(
+                gizmo, pick_gizmo_gpu(*gizmo, camera, position, input)
+            );
+    }
+}
+
+// Window rectangle of the context viewport, the whole window if it's empty
+static Rectangle get_context_viewport(const RGizmoContext *context) {
+    Rectangle viewport = context->viewport;
+    if (viewport.width <= 0.0f || viewport.height <= 0.0f) {
+        viewport = (Rectangle){
+            0.0f, 0.0f, (float)GetScreenWidth(), (float)GetScreenHeight()};
+    }
+    return viewport;
+}
+
+// Unloads what the context has created so far
+static void unload_context(RGizmoContext *context) {
+    if (context->shader_id) rlUnloadShaderProgram(context->shader_id);
+    if (context->scene_shader.id) UnloadShader(context->scene_shader);
+    if (context->vao) rlUnloadVertexArray(context->vao);
+    if (context->picking_fbo) {
+        rlUnloadFramebuffer(context->picking_fbo);
+        rlUnloadTexture(context->picking_texture);
+    }
+    if (context->picking_region_fbo) {
+        rlUnloadFramebuffer(context->picking_region_fbo);
+        rlUnloadTexture(context->picking_region_texture);
+    }
+
+#if defined(RAYGIZMO_DIRECT_GL)
+    unload_picking_pbos(context);
+#endif
+
+    RGizmoContext empty = {0};
+    *context = empty;
+}
+
+// Touches no GL, the GPU resources are created on their first use
+static void rgizmo_load(void) {
+    if (IS_LOADED) {
+        TraceLog(LOG_WARNING, "RAYGIZMO: Gizmo is already loaded, skip");
+        return;
+    }
+
+    CONTEXT = &DEFAULT_CONTEXT;
+
+    IS_LOADED = true;
+    TraceLog(LOG_INFO, "RAYGIZMO: Gizmo loaded");
+}
+
+void rgizmo_unload(void) {
+    if (!IS_LOADED) {
+        TraceLog(LOG_WARNING, "RAYGIZMO: Gizmo is already unloaded, skip");
+        return;
+    }
+
+    unload_context(&DEFAULT_CONTEXT);
+    unload_gizmo_mesh();
+    CONTEXT = &DEFAULT_CONTEXT;
+#if defined(STATS_GPU_TIMERS)
+    unload_gpu_timers();
+#endif
+
+    IS_LOADED = false;
+    TraceLog(LOG_INFO, "RAYGIZMO: Gizmo unloaded");
+}
+
+RGizmoContext *rgizmo_context_create(Rectangle viewport) {
+    if (!IS_LOADED) rgizmo_load();
+    RGizmoContext *context = (RGizmoContext *)calloc(
+        1, sizeof(RGizmoContext)
+    );
+    if (!context) {
+        set_error(RGIZMO_ERROR_OUT_OF_MEMORY, "Failed to allocate context");
+        return NULL;
+    }
+    context->viewport = viewport;
+    return context;
+}
+
+void rgizmo_context_destroy(RGizmoContext *context) {
+    if (!context || context == &DEFAULT_CONTEXT) return;
+    if (CONTEXT == context) CONTEXT = &DEFAULT_CONTEXT;
+    unload_context(context);
+    free(context);
+}
+
+// The picking fbo follows the new size on the next picking pass, which
+// also retries the picking if it has failed for the previous viewport
+void rgizmo_context_set_viewport(RGizmoContext *context, Rectangle viewport) {
+    Rectangle prev = context->viewport;
+    if (prev.x != viewport.x || prev.y != viewport.y
+        || prev.width != viewport.width || prev.height != viewport.height) {
+        context->is_picking_failed = false;
+    }
+    context->viewport = viewport;
+}
+
+void rgizmo_set_context(RGizmoContext *context) {
+    CONTEXT = context ? context : &DEFAULT_CONTEXT;
+}
+
+RGizmoError rgizmo_get_error(void) {
+    RGizmoError error = LAST_ERROR;
+    LAST_ERROR = RGIZMO_ERROR_NONE;
+    return error;
+}
+
+void rgizmo_set_program_cache(const char *file_name) {
+    PROGRAM_CACHE_FILE[0] = '\0';
+    if (!file_name) return;
+    strncpy(PROGRAM_CACHE_FILE, file_name, sizeof(PROGRAM_CACHE_FILE) - 1);
+#if !defined(RAYGIZMO_DIRECT_GL)
+    TraceLog(LOG_WARNING, "RAYGIZMO: Program cache needs RAYGIZMO_DIRECT_GL");
+#endif
+}
+
+RGizmo rgizmo_create(void) {
+    if (!IS_LOADED) rgizmo_load();
+    RGizmo gizmo = {0};
+    gizmo.view.size = 0.12f;
+    gizmo.view.handle_draw_thickness = 5.0f;
+    gizmo.view.active_axis_draw_thickness = 2.0f;
+    gizmo.view.axis_handle_length = 1.2f;
+    gizmo.view.axis_handle_tip_length = 0.3f;
+    gizmo.view.axis_handle_tip_radius = 0.1f;
+    gizmo.view.plane_handle_offset = 0.4f;
+    gizmo.view.plane_handle_size = 0.2f;
+    gizmo.view.lod_side_pixels = 6.0f;
+    gizmo.view.lod_min_sides = 8;
+    gizmo.view.lod_max_sides = 96;
+
+    return gizmo;
+}
+
+void rgizmo_solve(const RGizmoSolveInput *in, RGizmoSolveOutput *out) {
+    Camera3D camera = in->camera;
+    Vector3 position = in->position;
+    RGizmoInput input = in->input;
+    unsigned char picked_id = in->picked_id;
+    bool is_lmb_down = input.is_lmb_down;
+
+    out->state = in->state;
+    out->axis = in->axis;
+    out->angle = 0.0;
+    out->translation = Vector3Zero();
+
+    if (!is_lmb_down) out->state = RGIZMO_STATE_COLD;
+
+    if (out->state < RGIZMO_STATE_ACTIVE) {
+        if (picked_id < HANDLE_Y) out->axis = X_AXIS;
+        else if (picked_id < HANDLE_Z) out->axis = Y_AXIS;
+        else out->axis = Z_AXIS;
+
+        if (picked_id % 4 == 1)
+            out->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_ROT
+                                     : RGIZMO_STATE_HOT_ROT;
+        else if (picked_id % 4 == 2)
+            out->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_AXIS
+                                     : RGIZMO_STATE_HOT_AXIS;
+        else if (picked_id % 4 == 3)
+            out->state = is_lmb_down ? RGIZMO_STATE_ACTIVE_PLANE
+                                     : RGIZMO_STATE_HOT_PLANE;
+    }
+
+    Vector2 delta = input.mouse_delta;
+    bool is_mouse_moved = (fabs(delta.x) + fabs(delta.y)) > EPSILON;
+    if (!is_mouse_moved) return;
+
+    switch (out->state) {
+        case RGIZMO_STATE_ACTIVE_ROT: {
+            Vector2 p1 = Vector2Subtract(
+                input.mouse_position,
+                get_world_to_screen(position, camera, input)
+            );
+            Vector2 p0 = Vector2Subtract(p1, delta);
+
+            // Get angle between two vectors:
+            float angle = 0.0f;
+            float dot = Vector2DotProduct(
+                Vector2Normalize(p1), Vector2Normalize(p0)
+            );
+            if (1.0 - fabs(dot) > EPSILON) {
+                angle = acos(dot);
+                float z = p1.x * p0.y - p1.y * p0.x;
+
+                if (fabs(z) < EPSILON) angle = 0.0;
+                else if (z <= 0) angle *= -1.0;
+            }
+
+            // If we look at the gizmo from behind, we should flip the rotation
+            if (Vector3DotProduct(out->axis, position)
+                > Vector3DotProduct(out->axis, camera.position)) {
+                angle *= -1;
+            }
+
+            out->angle = angle;
+            break;
+        };
+        case RGIZMO_STATE_ACTIVE_AXIS: {
+            Vector2 p = Vector2Add(
+                get_world_to_screen(position, camera, input), delta
+            );
+            Ray r = get_screen_ray(p, camera, input);
+
+            // Get two lines nearest point
+            Vector3 line0point0 = camera.position;
+            Vector3 line0point1 = Vector3Add(line0point0, r.direction);
+            Vector3 line1point0 = position;
+            Vector3 line1point1 = Vector3Add(line1point0, out->axis);
+            Vector3 vec0 = Vector3Subtract(line0point1, line0point0);
+            Vector3 vec1 = Vector3Subtract(line1point1, line1point0);
+            Vector3 plane_vec = Vector3Normalize(Vector3CrossProduct(vec0, vec1)
+            );
+            Vector3 plane_normal = Vector3Normalize(
+                Vector3CrossProduct(vec0, plane_vec)
+            );
+
+            // Intersect line and plane
+            float dot = Vector3DotProduct(plane_normal, vec1);
+            if (fabs(dot) > EPSILON) {
+                Vector3 w = Vector3Subtract(line1point0, line0point0);
+                float k = -Vector3DotProduct(plane_normal, w) / dot;
+                Vector3 isect = Vector3Add(line1point0, Vector3Scale(vec1, k));
+                out->translation = Vector3Subtract(isect, position);
+            }
+            break;
+        }
+        case RGIZMO_STATE_ACTIVE_PLANE: {
+            Vector2 p = Vector2Add(
+                get_world_to_screen(position, camera, input), delta
+            );
+            Ray r = get_screen_ray(p, camera, input);
+
+            // Collide ray and plane
+            float denominator = r.direction.x * out->axis.x
+                                + r.direction.y * out->axis.y
+                                + r.direction.z * out->axis.z;
+
+            if (fabs(denominator) > EPSILON) {
+                float t = ((position.x - r.position.x) * out->axis.x
+                           + (position.y - r.position.y) * out->axis.y
+                           + (position.z - r.position.z) * out->axis.z)
+                          / denominator;
+
+                if (t > 0) {
+                    Vector3 c = Vector3Add(
+                        r.position, Vector3Scale(r.direction, t)
+                    );
+                    out->translation = Vector3Subtract(c, position);
+                }
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+// Digest of everything the drawing depends on besides the gizmo state
+static unsigned long long get_redraw_key(
+    const RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input
+) {
+    int screen_size[2] = {input.screen_width, input.screen_height};
+    unsigned long long key = 14695981039346656037ULL;
+    key = hash_bytes(key, &camera.position, sizeof(camera.position));
+    key = hash_bytes(key, &camera.target, sizeof(camera.target));
+    key = hash_bytes(key, &camera.up, sizeof(camera.up));
+    key = hash_bytes(key, &camera.fovy, sizeof(camera.fovy));
+    key = hash_bytes(key, &camera.projection, sizeof(camera.projection));
+    key = hash_bytes(key, &position, sizeof(position));
+    key = hash_bytes(key, screen_size, sizeof(screen_size));
+    key = hash_bytes(key, &gizmo->view, sizeof(gizmo->view));
+    return key;
+}
+
+// Accumulates the drag totals with one solved step, which has moved the
+// gizmo from the state before it and from the position. Returns the drag
+// begin and end changes
+static unsigned int accumulate_drag(
+    RGizmo *gizmo,
+    RGizmoState before,
+    Vector3 position,
+    Vector3 translation,
+    float angle
+) {
+    unsigned int changes = RGIZMO_CHANGE_NONE;
+    bool was_active = before >= RGIZMO_STATE_ACTIVE;
+    bool is_active = gizmo->state >= RGIZMO_STATE_ACTIVE;
+    bool is_begin = !gizmo->drag.is_active && (is_active || was_active);
+    bool is_end = (gizmo->drag.is_active || is_begin) && !is_active;
+
+    if (is_begin) {
+        changes |= RGIZMO_CHANGE_DRAG_BEGIN;
+        gizmo->drag.is_active = true;
+        gizmo->drag.position = position;
+        gizmo->drag.translation = Vector3Zero();
+        gizmo->drag.angle = 0.0f;
+    }
+    if (gizmo->drag.is_active) {
+        if (is_active) gizmo->drag.axis = gizmo->update.axis;
+        gizmo->drag.translation = Vector3Add(
+            gizmo->drag.translation, translation
+        );
+        gizmo->drag.angle += angle;
+    }
+    if (is_end) {
+        changes |= RGIZMO_CHANGE_DRAG_END;
+        gizmo->drag.is_active = false;
+    }
+    return changes;
+}
+
+// Compares the gizmo with its copy from before the update, adds the drag
+// changes of its steps and remembers the update input for
+// rgizmo_needs_redraw
+static unsigned int end_update(
+    RGizmo *gizmo,
+    RGizmo before,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    unsigned int drag_changes
+) {
+    unsigned int changes = drag_changes;
+    bool was_active = before.state >= RGIZMO_STATE_ACTIVE;
+    bool is_active = gizmo->state >= RGIZMO_STATE_ACTIVE;
+    if (was_active != is_active || drag_changes != RGIZMO_CHANGE_NONE) {
+        changes |= RGIZMO_CHANGE_ACTIVE;
+    } else if (before.state != gizmo->state
+               || get_hot_handle(before) != get_hot_handle(*gizmo)) {
+        changes |= RGIZMO_CHANGE_HOVER;
+    }
+    Vector3 translation = gizmo->update.translation;
+    if (translation.x != 0.0f || translation.y != 0.0f
+        || translation.z != 0.0f || gizmo->update.angle != 0.0f) {
+        changes |= RGIZMO_CHANGE_TRANSFORM;
+    }
+
+    gizmo->redraw.changes = changes;
+    gizmo->redraw.key = get_redraw_key(gizmo, camera, position, input);
+    gizmo->redraw.mouse_position = input.mouse_position;
+    gizmo->redraw.is_lmb_down = input.is_lmb_down;
+    return changes;
+}
+
+static unsigned int update_gizmo(
+    RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    unsigned char picked_id,
+    RGizmoInput input
+) {
+    RGizmo before = *gizmo;
+    RGizmoSolveInput in = {
+        gizmo->state, gizmo->update.axis, picked_id, camera, position, input};
+    RGizmoSolveOutput out;
+    double start = GetTime();
+    rgizmo_solve(&in, &out);
+    end_phase(RGIZMO_PHASE_SOLVE, start);
+
+    gizmo->picking.picked_id = picked_id;
+    gizmo->state = out.state;
+    gizmo->update.translation = out.translation;
+    gizmo->update.axis = out.axis;
+    gizmo->update.angle = out.angle;
+    unsigned int drag_changes = accumulate_drag(
+        gizmo, before.state, position, out.translation, out.angle
+    );
+    return end_update(gizmo, before, camera, position, input, drag_changes);
+}
+
+// The mouse position is relative to the viewport of the current context
+RGizmoInput rgizmo_get_input(void) {
+    Rectangle viewport = get_context_viewport(CONTEXT);
+    Vector2 mouse = GetMousePosition();
+    RGizmoInput input = {
+        {mouse.x - viewport.x, mouse.y - viewport.y},
+        GetMouseDelta(),
+        IsMouseButtonDown(0),
+        (int)viewport.width,
+        (int)viewport.height};
+    return input;
+}
+
+unsigned int rgizmo_update(
+    RGizmo *gizmo, Camera3D camera, Vector3 position
+) {
+    return rgizmo_update_ex(gizmo, camera, position, rgizmo_get_input());
+}
+
+unsigned int rgizmo_update_ex(
+    RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    if (!check_is_loaded()) return RGIZMO_CHANGE_NONE;
+
+    // -------------------------------------------------------------------
+    // Pick the handle under the mouse cursor
+    unsigned char picked_id = pick_gizmo(gizmo, camera, position, input);
+
+    // -------------------------------------------------------------------
+    // Update gizmo
+    return update_gizmo(gizmo, camera, position, picked_id, input);
+}
+
+unsigned int rgizmo_update_samples(
+    RGizmo *gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    const RGizmoPointerSample *samples,
+    int count
+) {
+    if (!check_is_loaded()) return RGIZMO_CHANGE_NONE;
+
+    int first = 0;
+    while (first < count && gizmo->has_last_sample
+           && samples[first].time <= gizmo->last_sample.time) {
+        first += 1;
+    }
+    if (first == count) {
+        input.mouse_delta = Vector2Zero();
+        return rgizmo_update_ex(gizmo, camera, position, input);
+    }
+    RGizmo before = *gizmo;
+
+    // -------------------------------------------------------------------
+    // Pick where the button was pressed, if it was, or at the newest sample
+    bool has_last_sample = gizmo->has_last_sample;
+    bool was_lmb_down = has_last_sample
+                            ? gizmo->last_sample.is_lmb_down
+                            : gizmo->state >= RGIZMO_STATE_ACTIVE;
+    int pick_idx = count - 1;
+    for (int i = first; i < count; ++i) {
+        if (samples[i].is_lmb_down && !was_lmb_down) {
+            pick_idx = i;
+            break;
+        }
+        was_lmb_down = samples[i].is_lmb_down;
+    }
+
+    RGizmoInput step = input;
+    step.mouse_position = samples[pick_idx].position;
+    step.is_lmb_down = samples[pick_idx].is_lmb_down;
+    unsigned char picked_id = rgizmo_pick(gizmo, camera, position, step);
+
+    // -------------------------------------------------------------------
+    // Solve every step from where the previous one has moved the gizmo.
+    // Once the drag is released, the later samples may only hover
+    Vector2 prev = has_last_sample ? gizmo->last_sample.position
+                                   : samples[first].position;
+    Vector3 step_position = position;
+    Vector3 translation = Vector3Zero();
+    float angle = 0.0f;
+    bool is_released = false;
+    unsigned int drag_changes = RGIZMO_CHANGE_NONE;
+
+    double start = GetTime();
+    for (int i = first; i < count; ++i) {
+        step.mouse_position = samples[i].position;
+        step.mouse_delta = Vector2Subtract(samples[i].position, prev);
+        step.is_lmb_down = samples[i].is_lmb_down;
+        prev = samples[i].position;
+        if (is_released) step.mouse_delta = Vector2Zero();
+
+        RGizmoSolveInput in = {
+            gizmo->state,
+            gizmo->update.axis,
+            picked_id,
+            camera,
+            step_position,
+            step};
+        RGizmoSolveOutput out;
+        rgizmo_solve(&in, &out);
+
+        RGizmoState state = gizmo->state;
+        gizmo->state = out.state;
+        gizmo->update.axis = out.axis;
+        if (state >= RGIZMO_STATE_ACTIVE && out.state < RGIZMO_STATE_ACTIVE) {
+            is_released = true;
+        }
+        drag_changes |= accumulate_drag(
+            gizmo, state, step_position, out.translation, out.angle
+        );
+
+        translation = Vector3Add(translation, out.translation);
+        step_position = Vector3Add(step_position, out.translation);
+        angle += out.angle;
+    }
+    end_phase(RGIZMO_PHASE_SOLVE, start);
+
+    gizmo->picking.picked_id = picked_id;
+    gizmo->update.translation = translation;
+    gizmo->update.angle = angle;
+    gizmo->has_last_sample = true;
+    gizmo->last_sample = samples[count - 1];
+    return end_update(gizmo, before, camera, position, step, drag_changes);
+}
+
+// Also updates the picking cache and statistics of the gizmo
+unsigned char rgizmo_pick(
+    RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    if (!check_is_loaded()) return 0;
+
+    return pick_gizmo(gizmo, camera, position, input);
+}
+
+unsigned int rgizmo_update_many(
+    RGizmo *gizmos, const Vector3 *positions, int count, Camera3D camera
+) {
+    return rgizmo_update_many_ex(
+        gizmos, positions, count, camera, rgizmo_get_input()
+    );
+}
+
+unsigned int rgizmo_update_many_ex(
+    RGizmo *gizmos,
+    const Vector3 *positions,
+    int count,
+    Camera3D camera,
+    RGizmoInput input
+) {
+    if (!check_is_loaded()) return RGIZMO_CHANGE_NONE;
+    if (count <= 0) return RGIZMO_CHANGE_NONE;
+    if (count > RGIZMO_UPDATE_MANY_MAX) {
+        TraceLog(
+            LOG_WARNING,
+            "RAYGIZMO: Too many gizmos to update (%d > %d), skip",
+            count,
+            RGIZMO_UPDATE_MANY_MAX
+        );
+        return RGIZMO_CHANGE_NONE;
+    }
+
+    bool is_lmb_down = input.is_lmb_down;
+    RGizmoPickMode mode = gizmos[0].picking.mode;
+    bool cursor_frustum = gizmos[0].picking.cursor_frustum;
+    int hover_radius = gizmos[0].picking.hover_radius;
+    bool has_scene = has_scene_ids(&gizmos[0]);
+    for (int i = 1; i < count; ++i) {
+        const RGizmo *gizmo = &gizmos[i];
+        if (gizmo->picking.mode != mode
+            || gizmo->picking.cursor_frustum != cursor_frustum
+            || gizmo->picking.hover_radius != hover_radius
+            || has_scene_ids(gizmo) != has_scene) {
+            TraceLog(
+                LOG_WARNING,
+                "RAYGIZMO: Gizmo %d has other picking settings than the "
+                "first one, they are ignored",
+                i
+            );
+            break;
+        }
+    }
+    if (mode != RGIZMO_PICK_CPU
+        && !require_picking(CONTEXT, input, mode, cursor_frustum, has_scene)) {
+        mode = RGIZMO_PICK_CPU;
+        has_scene = false;
+    }
+
+    // -------------------------------------------------------------------
+    // Nothing has to be picked while some handle is being dragged
+    bool is_dragging = false;
+    for (int i = 0; i < count && is_lmb_down; ++i) {
+        if (gizmos[i].state >= RGIZMO_STATE_ACTIVE) is_dragging = true;
+    }
+
+    // -------------------------------------------------------------------
+    // Collect gizmos which may be under the cursor, sorted from the
+    // farthest to the nearest. The handle type layers the picking pass,
+    // then the nearest gizmo is drawn last and wins within the type
+    int candidates[PICKING_MAX_CANDIDATES];
+    float dists[PICKING_MAX_CANDIDATES];
+    int n_candidates = 0;
+    for (int i = 0; i < count; ++i) {
+        RGizmo *gizmo = &gizmos[i];
+        gizmo->picking.cache.is_valid = false;
+        if (is_dragging) {
+            gizmo->picking.cache.n_hits += 1;
+            continue;
+        }
+
+        Rectangle bounds = get_screen_bounds(
+            *gizmo, camera, positions[i], input
+        );
+        if (!CheckCollisionPointRec(input.mouse_position, bounds)) {
+            gizmo->picking.cache.n_culls += 1;
+            continue;
+        }
+        gizmo->picking.cache.n_misses += 1;
+
+        float dist = Vector3DistanceSqr(camera.position, positions[i]);
+        if (n_candidates == PICKING_MAX_CANDIDATES) {
+            if (dist >= dists[0]) continue;
+            n_candidates -= 1;
+            memmove(&candidates[0], &candidates[1], n_candidates * sizeof(int));
+            memmove(&dists[0], &dists[1], n_candidates * sizeof(float));
+        }
+
+        int k = n_candidates++;
+        while (k > 0 && dists[k - 1] < dist) {
+            candidates[k] = candidates[k - 1];
+            dists[k] = dists[k - 1];
+            k -= 1;
+        }
+        candidates[k] = i;
+        dists[k] = dist;
+    }
+
+    // -------------------------------------------------------------------
+    // Pick the handle under the mouse cursor (handle id in the lowest
+    // byte, 1-based gizmo index in the next two) or the scene id
+    unsigned int picked = 0;
+    if (is_dragging) {
+        // Keep the picked ids, they are not used while dragging
+        for (int i = 0; i < count; ++i) {
+            if (gizmos[i].picking.picked_id) {
+                picked = gizmos[i].picking.picked_id | ((i + 1) << 8);
+            }
+        }
+    } else if (mode == RGIZMO_PICK_CPU) {
+        for (int k = 0; k < n_candidates; ++k) {
+            int i = candidates[k];
+            unsigned char id = pick_gizmo_cpu(
+                gizmos[i], camera, positions[i], input
+            );
+            if (id) picked = id | ((i + 1) << 8);
+        }
+#if defined(RAYGIZMO_DIRECT_GL)
+    } else if (mode == RGIZMO_PICK_GPU_ASYNC) {
+        picked = gizmos[0].picking.picked_scene_id << 8;
+        for (int i = 0; i < count; ++i) {
+            if (gizmos[i].picking.picked_id) {
+                picked = gizmos[i].picking.picked_id | ((i + 1) << 8);
+            }
+        }
+        consume_picking_pbos(gizmos, hover_radius, &picked, NULL);
+        PickingPbo *pbo = NULL;
+        if (n_candidates == 0 && !has_scene) picked = 0;
+        else pbo = get_free_picking_pbo(gizmos);
+        if (pbo) {
+            DrawPass pass = begin_picking_pass(
+                input, cursor_frustum
+            );
+            draw_scene_ids(gizmos[0], camera, pass);
+            draw_gizmos(
+                gizmos, positions, candidates, n_candidates, camera, pass, true
+            );
+            end_picking_pass();
+            queue_picking_pbo(pbo, gizmos, 0, input, cursor_frustum);
+        }
+#endif
+    } else if (n_candidates > 0 || has_scene) {
+        DrawPass pass = begin_picking_pass(input, cursor_frustum);
+        draw_scene_ids(gizmos[0], camera, pass);
+        draw_gizmos(
+            gizmos, positions, candidates, n_candidates, camera, pass, true
+        );
+        end_picking_pass();
+        picked = read_picking_pixels(
+            input, cursor_frustum, hover_radius
+        );
+    }
+
+    // -------------------------------------------------------------------
+    // Update gizmos, only the picked one may become hot or active. The
+    // scene id goes to all of them
+    int picked_idx = picked & 0xFF ? (int)(picked >> 8) - 1 : -1;
+    unsigned int changes = RGIZMO_CHANGE_NONE;
+    for (int i = 0; i < count; ++i) {
+        unsigned char picked_id = i == picked_idx ? picked & 0xFF : 0;
+        gizmos[i].picking.picked_scene_id = picked & 0xFF ? 0 : picked >> 8;
+        changes |= update_gizmo(
+            &gizmos[i], camera, positions[i], picked_id, input
+        );
+    }
+    return changes;
+}
+
+bool rgizmo_needs_redraw(
+    const RGizmo *gizmo, Camera3D camera, Vector3 position, RGizmoInput input
+) {
+    if (gizmo->redraw.changes != RGIZMO_CHANGE_NONE) return true;
+#if defined(RAYGIZMO_DIRECT_GL)
+    // Only the next update delivers the pick of a fenced readback
+    const RGizmoContext *context = CONTEXT;
+    for (int i = 0; i < context->n_picking_pbos; ++i) {
+        const PickingPbo *pbo = &context->picking_pbos[i];
+        if (pbo->fence && pbo->owner == gizmo) return true;
+    }
+#endif
+    if (get_redraw_key(gizmo, camera, position, input) != gizmo->redraw.key) {
+        return true;
+    }
+    if (input.is_lmb_down != gizmo->redraw.is_lmb_down
+        && gizmo->state != RGIZMO_STATE_COLD) {
+        return true;
+    }
+
+    Vector2 last = gizmo->redraw.mouse_position;
+    if (input.mouse_position.x == last.x && input.mouse_position.y == last.y) {
+        return false;
+    }
+    if (gizmo->state >= RGIZMO_STATE_ACTIVE) return true;
+
+    Rectangle bounds = get_screen_bounds(*gizmo, camera, position, input);
+    return CheckCollisionPointRec(input.mouse_position, bounds)
+           || CheckCollisionPointRec(last, bounds);
+}
+
+void rgizmo_invalidate_pick_cache(RGizmo *gizmo) {
+    gizmo->picking.cache.is_valid = false;
+}
+
+void rgizmo_set_scene_id(unsigned int id) {
+    const RGizmoContext *context = CONTEXT;
+    if (!context->scene_shader.id) return;
+    Vector4 value = {
+        0.0f,
+        (float)(id & 0xFF) / 255.0f,
+        (float)((id >> 8) & 0xFF) / 255.0f,
+        (float)((id >> 16) & 0xFF) / 255.0f};
+
+    rlDrawRenderBatchActive();
+    rlEnableShader(context->scene_shader.id);
+    rlSetUniform(
+        context->scene_shader_id_loc, &value, RL_SHADER_UNIFORM_VEC4, 1
+    );
+    rlDisableShader();
+}
+
+Rectangle rgizmo_get_screen_bounds(
+    RGizmo gizmo, Camera3D camera, Vector3 position
+) {
+    return get_screen_bounds(gizmo, camera, position, rgizmo_get_input());
+}
+
+void rgizmo_draw(RGizmo gizmo, Camera3D camera, Vector3 position) {
+    if (!check_is_loaded()) return;
+
+    double start = GetTime();
+    begin_gpu_timer(RGIZMO_PHASE_DRAW);
+
+    DrawPass pass = get_screen_pass();
+    draw_gizmos(&gizmo, &position, NULL, 1, camera, pass, false);
+
+    end_gpu_timer(RGIZMO_PHASE_DRAW);
+    end_phase(RGIZMO_PHASE_DRAW, start);
+}
+
+// Draws all gizmos with the same few instanced draw calls as one gizmo
+void rgizmo_draw_many(
+    const RGizmo *gizmos, const Vector3 *positions, int count, Camera3D camera
+) {
+    if (!check_is_loaded()) return;
+
+    double start = GetTime();
+    begin_gpu_timer(RGIZMO_PHASE_DRAW);
+
+    DrawPass pass = get_screen_pass();
+    draw_gizmos(gizmos, positions, NULL, count, camera, pass, false);
+
+    end_gpu_timer(RGIZMO_PHASE_DRAW);
+    end_phase(RGIZMO_PHASE_DRAW, start);
+}
+
+// Translation followed by the rotation about the gizmo position, in the
+// closed form: x' = R * (x + t - p) + p
+Matrix rgizmo_get_tranform(RGizmo gizmo, Vector3 position) {
+    Matrix transform = MatrixRotate(gizmo.update.axis, gizmo.update.angle);
+    Vector3 offset = Vector3Transform(
+        Vector3Subtract(gizmo.update.translation, position), transform
+    );
+
+    transform.m12 = offset.x + position.x;
+    transform.m13 = offset.y + position.y;
+    transform.m14 = offset.z + position.z;
+    return transform;
+}
+
+Matrix rgizmo_get_drag_transform(RGizmo gizmo) {
+    RGizmo total = gizmo;
+    total.update.translation = gizmo.drag.translation;
+    total.update.axis = gizmo.drag.axis;
+    total.update.angle = gizmo.drag.angle;
+    return rgizmo_get_tranform(total, gizmo.drag.position);
+}
+
+// ---------------------------------------------------------------------------
+// Draw list
+
+// The vertex shader on the CPU: the world position of the mesh vertex, the
+// lines are extruded by the half of the line width in pixels of the input
+// screen and unprojected back at the same depth
+static Vector3 get_mesh_vertex_position(
+    MeshVertex vertex,
+    MeshInstance instance,
+    Matrix mvp,
+    Matrix inv_mvp,
+    RGizmoInput input
+) {
+    float params[4] = {
+        1.0f, instance.params.x, instance.params.y, instance.params.z};
+    float offset_params[2] = {instance.params.w, instance.params2.x};
+    float weight = 0.0f;
+    float offset_weight = 0.0f;
+    for (int i = 0; i < 4; ++i) weight += vertex.weights[i] * params[i];
+    for (int i = 0; i < 2; ++i) {
+        offset_weight += vertex.offset_weights[i] * offset_params[i];
+    }
+
+    float radius = instance.position.w;
+    Vector3 center = {
+        instance.position.x, instance.position.y, instance.position.z};
+    Vector3 p = Vector3Add(
+        center,
+        Vector3Scale(
+            Vector3Add(
+                Vector3Scale(vertex.position, weight),
+                Vector3Scale(vertex.offset, offset_weight)
+            ),
+            radius
+        )
+    );
+    if (vertex.tangent.w == 0.0f) return p;
+
+    Vector3 tangent = {vertex.tangent.x, vertex.tangent.y, vertex.tangent.z};
+    Vector3 q = Vector3Add(p, Vector3Scale(tangent, 0.01f * radius));
+    Quaternion clip = QuaternionTransform(
+        (Quaternion){p.x, p.y, p.z, 1.0f}, mvp
+    );
+    Quaternion next = QuaternionTransform(
+        (Quaternion){q.x, q.y, q.z, 1.0f}, mvp
+    );
+    Vector2 size = {(float)input.screen_width, (float)input.screen_height};
+    Vector2 dir = {
+        (next.x / next.w - clip.x / clip.w) * size.x,
+        (next.y / next.w - clip.y / clip.w) * size.y};
+    if (Vector2LengthSqr(dir) > 0.0f) {
+        Vector2 normal = Vector2Normalize((Vector2){-dir.y, dir.x});
+        float width = vertex.tangent.w * instance.params2.y * clip.w;
+        clip.x += normal.x * width / size.x;
+        clip.y += normal.y * width / size.y;
+    }
+
+    Quaternion world = QuaternionTransform(clip, inv_mvp);
+    return (Vector3){
+        world.x / world.w, world.y / world.w, world.z / world.w};
+}
+
+static Vector3 rotate_axes(Vector3 v, int k) {
+    if (k == 2) return (Vector3){v.y, v.z, v.x};
+    if (k == 1) return (Vector3){v.z, v.x, v.y};
+    return v;
+}
+
+// Adds the vertex, or reuses one of the few last vertices of the gizmo if
+// it's the same (the triangles of a quad share their vertices)
+static void push_draw_list_vertex(
+    RGizmoDrawList *list, int first_vertex, RGizmoDrawVertex vertex
+) {
+    int idx = list->n_vertices;
+    for (int i = list->n_vertices - 1;
+         i >= first_vertex && i >= list->n_vertices - 6;
+         --i) {
+        RGizmoDrawVertex *other = &list->vertices[i];
+        if (Vector3Equals(other->position, vertex.position)
+            && ColorToInt(other->color) == ColorToInt(vertex.color)
+            && other->handle_id == vertex.handle_id) {
+            idx = i;
+            break;
+        }
+    }
+
+    if (idx == list->n_vertices) list->vertices[list->n_vertices++] = vertex;
+    list->indices[list->n_indices++] = (unsigned short)idx;
+}
+
+// Pushes the mesh triangles of the range, the axis and plane handles are
+// rotated into the handle of their slot
+static bool push_draw_list_range(
+    RGizmoDrawList *list,
+    int first_vertex,
+    const MeshVertex *vertices,
+    int count,
+    int k,
+    MeshInstance instance,
+    Matrix mvp,
+    Matrix inv_mvp,
+    RGizmoInput input
+) {
+    Color colors[3] = {RED, GREEN, BLUE};
+    HandleColors ids = PICKING_COLORS;
+    Color handle_ids[9] = {
+        ids.rot.x,
+        ids.rot.y,
+        ids.rot.z,
+        ids.axis.x,
+        ids.axis.y,
+        ids.axis.z,
+        ids.plane.x,
+        ids.plane.y,
+        ids.plane.z};
+
+    for (int i = 0; i < count; i += 3) {
+        if (list->n_vertices + 3 > list->max_vertices
+            || list->n_vertices + 3 > 0xFFFF
+            || list->n_indices + 3 > list->max_indices) {
+            return false;
+        }
+
+        for (int j = i; j < i + 3; ++j) {
+            MeshVertex vertex = vertices[j];
+            Vector3 tangent = rotate_axes(
+                (Vector3){vertex.tangent.x, vertex.tangent.y, vertex.tangent.z},
+                k
+            );
+            vertex.position = rotate_axes(vertex.position, k);
+            vertex.offset = rotate_axes(vertex.offset, k);
+            vertex.tangent = (Vector4){
+                tangent.x, tangent.y, tangent.z, vertex.tangent.w};
+
+            int handle = (int)vertex.handle + k;
+            RGizmoDrawVertex v = {
+                get_mesh_vertex_position(vertex, instance, mvp, inv_mvp, input),
+                colors[handle % 3],
+                handle_ids[handle].r};
+            if (handle == (int)instance.params2.z) v.color = WHITE;
+            push_draw_list_vertex(list, first_vertex, v);
+        }
+    }
+    return true;
+}
+
+bool rgizmo_build_draw_list(
+    RGizmo gizmo,
+    Camera3D camera,
+    Vector3 position,
+    RGizmoInput input,
+    RGizmoDrawList *list
+) {
+    if (MESH_ROT_RANGE.count == 0) build_gizmo_mesh();
+
+    int first_vertex = list->n_vertices;
+    int first_index = list->n_indices;
+    MeshInstance instance = get_mesh_instance(
+        gizmo, camera, position, get_hot_handle(gizmo), 0
+    );
+    Matrix mvp = MatrixMultiply(
+        MatrixLookAt(camera.position, camera.target, camera.up),
+        get_camera_projection(camera, input)
+    );
+    Matrix inv_mvp = MatrixInvert(mvp);
+    Handles planes = get_plane_handles(
+        gizmo, camera, position, PICKING_COLORS.plane
+    );
+    Handles axes = get_axis_handles(
+        gizmo, camera, position, PICKING_COLORS.axis
+    );
+    bool is_ok = true;
+
+    // ---------------------------------------------------------------
+    // Plane handles, from the farthest to the nearest
+    for (int slot = 0; slot < 3 && is_ok; ++slot) {
+        MeshRange range = MESH_PLANE_RANGES[slot];
+        is_ok = push_draw_list_range(
+            list,
+            first_vertex,
+            &MESH_VERTICES[range.offset],
+            range.count,
+            planes.arr[slot].idx,
+            instance,
+            mvp,
+            inv_mvp,
+            input
+        );
+    }
+
+    // ---------------------------------------------------------------
+    // Rotation handles: line segments of the rings (the shader draws them
+    // per pixel), the back half is cut by the segment centers
+    {
+        Vector3 u[3] = {Vector3Negate(Z_AXIS), X_AXIS, X_AXIS};
+        Vector3 v[3] = {Y_AXIS, Z_AXIS, Y_AXIS};
+        float sides[6] = {-1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f};
+        float radius = instance.position.w;
+        int n_segments = get_lod_sides(
+            gizmo,
+            get_screen_radius(
+                camera, position, radius, (float)input.screen_height
+            )
+        );
+
+        for (int i = 0; i < 3 && is_ok; ++i) {
+            for (int k = 0; k < n_segments && is_ok; ++k) {
+                float a0 = 2.0f * PI * k / n_segments;
+                float a1 = 2.0f * PI * (k + 1) / n_segments;
+                Vector3 p0 = Vector3Add(
+                    Vector3Scale(u[i], sinf(a0)), Vector3Scale(v[i], cosf(a0))
+                );
+                Vector3 p1 = Vector3Add(
+                    Vector3Scale(u[i], sinf(a1)), Vector3Scale(v[i], cosf(a1))
+                );
+
+                Vector3 mid = Vector3Add(
+                    position, Vector3Scale(Vector3Lerp(p0, p1, 0.5f), radius)
+                );
+                Vector3 r = Vector3Normalize(Vector3Subtract(mid, position));
+                Vector3 c = Vector3Normalize(
+                    Vector3Subtract(mid, camera.position)
+                );
+                if (Vector3DotProduct(r, c) > 0.1f) continue;
+
+                Vector3 t = Vector3Normalize(Vector3Subtract(p1, p0));
+                Vector3 positions[6] = {p0, p0, p1, p0, p1, p1};
+                MeshVertex vertices[6];
+                for (int j = 0; j < 6; ++j) {
+                    MeshVertex vertex = {
+                        positions[j],
+                        {1.0f, 0.0f, 0.0f, 0.0f},
+                        Vector3Zero(),
+                        {0.0f, 0.0f},
+                        {t.x, t.y, t.z, sides[j]},
+                        (float)i,
+                        -1.0f};
+                    vertices[j] = vertex;
+                }
+                is_ok = push_draw_list_range(
+                    list,
+                    first_vertex,
+                    vertices,
+                    6,
+                    0,
+                    instance,
+                    mvp,
+                    inv_mvp,
+                    input
+                );
+            }
+        }
+    }
+
+    // ---------------------------------------------------------------
+    // Axis handles, from the farthest to the nearest
+    int lod = get_cone_lod(
+        gizmo, camera, position, (float)input.screen_height
+    );
+    for (int slot = 0; slot < 3 && is_ok; ++slot) {
+        MeshRange range = MESH_AXIS_RANGES[lod][slot];
+        is_ok = push_draw_list_range(
+            list,
+            first_vertex,
+            &MESH_VERTICES[range.offset],
+            range.count,
+            axes.arr[slot].idx,
+            instance,
+            mvp,
+            inv_mvp,
+            input
+        );
+    }
+
+    if (!is_ok) {
+        list->n_vertices = first_vertex;
+        list->n_indices = first_index;
+    }
+    return is_ok;
+}
+
+unsigned char rgizmo_pick_draw_list(
+    const RGizmoDrawList *list, Camera3D camera, RGizmoInput input
+) {
+    Matrix mvp = MatrixMultiply(
+        MatrixLookAt(camera.position, camera.target, camera.up),
+        get_camera_projection(camera, input)
+    );
+    unsigned char picked_id = 0;
+
+    for (int i = 0; i + 2 < list->n_indices; i += 3) {
+        Vector2 points[3];
+        bool is_visible = true;
+        for (int k = 0; k < 3; ++k) {
+            Vector3 p = list->vertices[list->indices[i + k]].position;
+            Quaternion clip = QuaternionTransform(
+                (Quaternion){p.x, p.y, p.z, 1.0f}, mvp
+            );
+            if (clip.w <= 0.0f) is_visible = false;
+            points[k] = (Vector2){
+                (clip.x / clip.w + 1.0f) / 2.0f * (float)input.screen_width,
+                (-clip.y / clip.w + 1.0f) / 2.0f * (float)input.screen_height};
+        }
+
+        if (is_visible
+            && CheckCollisionPointTriangle(
+                input.mouse_position, points[0], points[1], points[2]
+            )) {
+            picked_id = list->vertices[list->indices[i]].handle_id;
+        }
+    }
+
+    return picked_id;
+}
+
+// ---------------------------------------------------------------------------
+// Batch transform
+#define BATCH_MIN_JOB_SIZE 4096
+
+#if defined(BATCH_AVX)
+typedef __m256 BatchVec;
+#define BATCH_WIDTH 8
+#define batch_load(p) _mm256_loadu_ps(p)
+#define batch_store(p, v) _mm256_storeu_ps(p, v)
+#define batch_set1(x) _mm256_set1_ps(x)
+#define batch_add(a, b) _mm256_add_ps(a, b)
+#define batch_mul(a, b) _mm256_mul_ps(a, b)
+#define batch_min(a, b) _mm256_min_ps(a, b)
+#define batch_max(a, b) _mm256_max_ps(a, b)
+#elif defined(BATCH_SSE)
+typedef __m128 BatchVec;
+#define BATCH_WIDTH 4
+#define batch_load(p) _mm_loadu_ps(p)
+#define batch_store(p, v) _mm_storeu_ps(p, v)
+#define batch_set1(x) _mm_set1_ps(x)
+#define batch_add(a, b) _mm_add_ps(a, b)
+#define batch_mul(a, b) _mm_mul_ps(a, b)
+#define batch_min(a, b) _mm_min_ps(a, b)
+#define batch_max(a, b) _mm_max_ps(a, b)
+#elif defined(BATCH_NEON)
+typedef float32x4_t BatchVec;
+#define BATCH_WIDTH 4
+#define batch_load(p) vld1q_f32(p)
+#define batch_store(p, v) vst1q_f32(p, v)
+#define batch_set1(x) vdupq_n_f32(x)
+#define batch_add(a, b) vaddq_f32(a, b)
+#define batch_mul(a, b) vmulq_f32(a, b)
+#define batch_min(a, b) vminq_f32(a, b)
+#define batch_max(a, b) vmaxq_f32(a, b)
+#else
+typedef float BatchVec;
+#define BATCH_WIDTH 1
+#define batch_load(p) (*(p))
+#define batch_store(p, v) (*(p) = (v))
+#define batch_set1(x) (x)
+#define batch_add(a, b) ((a) + (b))
+#define batch_mul(a, b) ((a) * (b))
+#define batch_min(a, b) fminf(a, b)
+#define batch_max(a, b) fmaxf(a, b)
+#endif
+
+// Delta rows: x' = rows[0] . (x, y, z, 1) and so on, the same as the
+// Matrix memory layout. The rotation is applied to the quaternions
+typedef struct BatchDelta {
+    float rows[3][4];
+    Quaternion rotation;
+} BatchDelta;
+
+typedef struct BatchBounds {
+    Vector3 sum;
+    Vector3 min;
+    Vector3 max;
+} BatchBounds;
+
+typedef struct BatchJob {
+    const BatchDelta *delta;
+    Matrix *matrices;
+    RGizmoTransforms soa;
+    int begin;
+    int end;
+    BatchBounds bounds;
+} BatchJob;
+
+static BatchDelta get_batch_delta(RGizmo gizmo, Vector3 position) {
+    Matrix m = rgizmo_get_tranform(gizmo, position);
+    BatchDelta delta = {
+        {{m.m0, m.m4, m.m8, m.m12},
+         {m.m1, m.m5, m.m9, m.m13},
+         {m.m2, m.m6, m.m10, m.m14}},
+        {0.0f, 0.0f, 0.0f, 1.0f}};
+    delta.rotation = QuaternionFromAxisAngle(
+        gizmo.update.axis, gizmo.update.angle
+    );
+    return delta;
+}
+
+static void add_batch_point(BatchBounds *bounds, Vector3 p) {
+    bounds->sum = Vector3Add(bounds->sum, p);
+    bounds->min = Vector3Min(bounds->min, p);
+    bounds->max = Vector3Max(bounds->max, p);
+}
+
+// Matrices are multiplied by the delta on the right, so every result row
+// (in the memory layout) is a combination of the source rows
+static void apply_batch_matrices(BatchJob *job) {
+    const BatchDelta *d = job->delta;
+    for (int i = job->begin; i < job->end; ++i) {
+        float *m = (float *)&job->matrices[i];
+#if defined(BATCH_SSE)
+        __m128 a[4] = {
+            _mm_loadu_ps(m),
+            _mm_loadu_ps(m + 4),
+            _mm_loadu_ps(m + 8),
+            _mm_loadu_ps(m + 12)};
+        for (int r = 0; r < 3; ++r) {
+            __m128 row = _mm_mul_ps(a[0], _mm_set1_ps(d->rows[r][0]));
+            for (int k = 1; k < 4; ++k) {
+                row = _mm_add_ps(
+                    row, _mm_mul_ps(a[k], _mm_set1_ps(d->rows[r][k]))
+                );
+            }
+            _mm_storeu_ps(m + 4 * r, row);
+        }
+#elif defined(BATCH_NEON)
+        float32x4_t a[4] = {
+            vld1q_f32(m),
+            vld1q_f32(m + 4),
+            vld1q_f32(m + 8),
+            vld1q_f32(m + 12)};
+        for (int r = 0; r < 3; ++r) {
+            float32x4_t row = vmulq_n_f32(a[0], d->rows[r][0]);
+            for (int k = 1; k < 4; ++k) {
+                row = vmlaq_n_f32(row, a[k], d->rows[r][k]);
+            }
+            vst1q_f32(m + 4 * r, row);
+        }
+#else
+        float a[16];
+        memcpy(a, m, sizeof(a));
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                m[4 * r + c] = d->rows[r][0] * a[c] + d->rows[r][1] * a[4 + c]
+                               + d->rows[r][2] * a[8 + c]
+                               + d->rows[r][3] * a[12 + c];
+            }
+        }
+#endif
+        add_batch_point(&job->bounds, (Vector3){m[3], m[7], m[11]});
+    }
+}
+
+// Transforms BATCH_WIDTH objects starting from i in place
+static void apply_batch_soa_step(
+    const BatchDelta *d,
+    RGizmoTransforms t,
+    int i,
+    BatchVec *x,
+    BatchVec *y,
+    BatchVec *z
+) {
+    BatchVec px = batch_load(t.x + i);
+    BatchVec py = batch_load(t.y + i);
+    BatchVec pz = batch_load(t.z + i);
+    BatchVec p[3];
+    for (int r = 0; r < 3; ++r) {
+        p[r] = batch_add(
+            batch_add(
+                batch_mul(px, batch_set1(d->rows[r][0])),
+                batch_mul(py, batch_set1(d->rows[r][1]))
+            ),
+            batch_add(
+                batch_mul(pz, batch_set1(d->rows[r][2])),
+                batch_set1(d->rows[r][3])
+            )
+        );
+    }
+    batch_store(t.x + i, p[0]);
+    batch_store(t.y + i, p[1]);
+    batch_store(t.z + i, p[2]);
+    *x = p[0];
+    *y = p[1];
+    *z = p[2];
+
+    if (!t.qw) return;
+
+    // q' = r * q
+    Quaternion r = d->rotation;
+    BatchVec rx = batch_set1(r.x), nrx = batch_set1(-r.x);
+    BatchVec ry = batch_set1(r.y), nry = batch_set1(-r.y);
+    BatchVec rz = batch_set1(r.z), nrz = batch_set1(-r.z);
+    BatchVec rw = batch_set1(r.w);
+    BatchVec qx = batch_load(t.qx + i);
+    BatchVec qy = batch_load(t.qy + i);
+    BatchVec qz = batch_load(t.qz + i);
+    BatchVec qw = batch_load(t.qw + i);
+    batch_store(
+        t.qx + i,
+        batch_add(
+            batch_add(batch_mul(rx, qw), batch_mul(rw, qx)),
+            batch_add(batch_mul(ry, qz), batch_mul(nrz, qy))
+        )
+    );
+    batch_store(
+        t.qy + i,
+        batch_add(
+            batch_add(batch_mul(ry, qw), batch_mul(rw, qy)),
+            batch_add(batch_mul(rz, qx), batch_mul(nrx, qz))
+        )
+    );
+    batch_store(
+        t.qz + i,
+        batch_add(
+            batch_add(batch_mul(rz, qw), batch_mul(rw, qz)),
+            batch_add(batch_mul(rx, qy), batch_mul(nry, qx))
+        )
+    );
+    batch_store(
+        t.qw + i,
+        batch_add(
+            batch_add(batch_mul(rw, qw), batch_mul(nrx, qx)),
+            batch_add(batch_mul(nry, qy), batch_mul(nrz, qz))
+        )
+    );
+}
+
+static void apply_batch_soa(BatchJob *job) {
+    RGizmoTransforms t = job->soa;
+    BatchVec x, y, z;
+    BatchVec sum[3] = {batch_set1(0.0f), batch_set1(0.0f), batch_set1(0.0f)};
+    BatchVec min[3] = {
+        batch_set1(FLT_MAX), batch_set1(FLT_MAX), batch_set1(FLT_MAX)};
+    BatchVec max[3] = {
+        batch_set1(-FLT_MAX), batch_set1(-FLT_MAX), batch_set1(-FLT_MAX)};
+
+    int i = job->begin;
+    for (; i + BATCH_WIDTH <= job->end; i += BATCH_WIDTH) {
+        apply_batch_soa_step(job->delta, t, i, &x, &y, &z);
+        sum[0] = batch_add(sum[0], x);
+        sum[1] = batch_add(sum[1], y);
+        sum[2] = batch_add(sum[2], z);
+        min[0] = batch_min(min[0], x);
+        min[1] = batch_min(min[1], y);
+        min[2] = batch_min(min[2], z);
+        max[0] = batch_max(max[0], x);
+        max[1] = batch_max(max[1], y);
+        max[2] = batch_max(max[2], z);
+    }
+
+    float lanes[3][3][BATCH_WIDTH];
+    for (int k = 0; k < 3; ++k) {
+        batch_store(lanes[0][k], sum[k]);
+        batch_store(lanes[1][k], min[k]);
+        batch_store(lanes[2][k], max[k]);
+    }
+    for (int lane = 0; lane < BATCH_WIDTH; ++lane) {
+        job->bounds.sum.x += lanes[0][0][lane];
+        job->bounds.sum.y += lanes[0][1][lane];
+        job->bounds.sum.z += lanes[0][2][lane];
+        Vector3 lane_min = {
+            lanes[1][0][lane], lanes[1][1][lane], lanes[1][2][lane]};
+        Vector3 lane_max = {
+            lanes[2][0][lane], lanes[2][1][lane], lanes[2][2][lane]};
+        job->bounds.min = Vector3Min(job->bounds.min, lane_min);
+        job->bounds.max = Vector3Max(job->bounds.max, lane_max);
+    }
+
+    // The tail is copied into a full width block, so the same kernel is used
+    int n_tail = job->end - i;
+    if (n_tail > 0) {
+        float block[7][BATCH_WIDTH] = {{0.0f}};
+        float *arrays[7] = {t.x, t.y, t.z, t.qx, t.qy, t.qz, t.qw};
+        int n_arrays = t.qw ? 7 : 3;
+        for (int k = 0; k < n_arrays; ++k) {
+            memcpy(block[k], arrays[k] + i, n_tail * sizeof(float));
+        }
+
+        RGizmoTransforms tail = {
+            block[0],
+            block[1],
+            block[2],
+            t.qw ? block[3] : NULL,
+            t.qw ? block[4] : NULL,
+            t.qw ? block[5] : NULL,
+            t.qw ? block[6] : NULL,
+            BATCH_WIDTH};
+        apply_batch_soa_step(job->delta, tail, 0, &x, &y, &z);
+
+        for (int k = 0; k < n_arrays; ++k) {
+            memcpy(arrays[k] + i, block[k], n_tail * sizeof(float));
+        }
+        for (int lane = 0; lane < n_tail; ++lane) {
+            add_batch_point(
+                &job->bounds,
+                (Vector3){block[0][lane], block[1][lane], block[2][lane]}
+            );
+        }
+    }
+}
+
+static void *run_batch_job(void *arg) {
+    BatchJob *job = (BatchJob *)arg;
+    if (job->matrices) apply_batch_matrices(job);
+    else apply_batch_soa(job);
+    return NULL;
+}
+
+static Vector3 run_batch(
+    RGizmo gizmo,
+    Vector3 position,
+    Matrix *matrices,
+    RGizmoTransforms soa,
+    int count,
+    RGizmoPivot pivot
+) {
+    if (count <= 0) return position;
+
+    BatchDelta delta = get_batch_delta(gizmo, position);
+    int n_jobs = (count + BATCH_MIN_JOB_SIZE - 1) / BATCH_MIN_JOB_SIZE;
+    if (n_jobs > BATCH_THREADS) n_jobs = BATCH_THREADS;
+
+    BatchJob jobs[BATCH_THREADS];
+    for (int k = 0; k < n_jobs; ++k) {
+        BatchJob job = {
+            &delta,
+            matrices,
+            soa,
+            (int)((long long)count * k / n_jobs),
+            (int)((long long)count * (k + 1) / n_jobs),
+            {Vector3Zero(),
+             {FLT_MAX, FLT_MAX, FLT_MAX},
+             {-FLT_MAX, -FLT_MAX, -FLT_MAX}}};
+        jobs[k] = job;
+    }
+
+#if BATCH_THREADS > 1
+    pthread_t threads[BATCH_THREADS];
+    bool is_started[BATCH_THREADS] = {false};
+    for (int k = 1; k < n_jobs; ++k) {
+        is_started[k] = pthread_create(
+                            &threads[k], NULL, run_batch_job, &jobs[k]
+                        )
+                        == 0;
+        if (!is_started[k]) run_batch_job(&jobs[k]);
+    }
+    run_batch_job(&jobs[0]);
+    for (int k = 1; k < n_jobs; ++k) {
+        if (is_started[k]) pthread_join(threads[k], NULL);
+    }
+#else
+    run_batch_job(&jobs[0]);
+#endif
+
+    BatchBounds bounds = jobs[0].bounds;
+    for (int k = 1; k < n_jobs; ++k) {
+        bounds.sum = Vector3Add(bounds.sum, jobs[k].bounds.sum);
+        bounds.min = Vector3Min(bounds.min, jobs[k].bounds.min);
+        bounds.max = Vector3Max(bounds.max, jobs[k].bounds.max);
+    }
+
+    if (pivot == RGIZMO_PIVOT_BOUNDS_CENTER) {
+        return Vector3Scale(Vector3Add(bounds.min, bounds.max), 0.5f);
+    }
+    return Vector3Scale(bounds.sum, 1.0f / count);
+}
+
+Vector3 rgizmo_apply_transform_batch(
+    RGizmo gizmo,
+    Vector3 position,
+    Matrix *transforms,
+    int count,
+    RGizmoPivot pivot
+) {
+    RGizmoTransforms soa = {0};
+    return run_batch(gizmo, position, transforms, soa, count, pivot);
+}
+
+Vector3 rgizmo_apply_transform_batch_soa(
+    RGizmo gizmo,
+    Vector3 position,
+    RGizmoTransforms transforms,
+    RGizmoPivot pivot
+) {
+    return run_batch(
+        gizmo, position, NULL, transforms, transforms.count, pivot
+    );
+}
+
+// ---------------------------------------------------------------------------
+// Stats
+RGizmoStats rgizmo_get_stats(void) {
+#if defined(STATS_GPU_TIMERS)
+    if (STATS_TIMERS_LOADED) {
+        for (int i = 0; i < RGIZMO_PHASE_COUNT; ++i) collect_gpu_timer(i);
+    }
+#endif
+    return STATS;
+}
+
+void rgizmo_reset_stats(void) {
+    RGizmoStats empty = {0};
+    STATS = empty;
+    STATS_N_EVENTS = 0;
+}
+
+// Growing text of the chrome trace
+typedef struct TraceText {
+    char *data;
+    size_t size;
+    size_t capacity;
+} TraceText;
+
+// Appends the formatted line, growing the text if it doesn't fit. Returns
+// false (the text is kept) if it can't be formatted or allocated
+static bool append_trace_text(TraceText *text, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(
+        text->data + text->size, text->capacity - text->size, format, args
+    );
+    va_end(args);
+    if (n < 0) return false;
+    if ((size_t)n < text->capacity - text->size) {
+        text->size += n;
+        return true;
+    }
+
+    size_t capacity = 2 * text->capacity;
+    if (capacity < text->size + n + 1) capacity = text->size + n + 1;
+    char *data = (char *)realloc(text->data, capacity);
+    if (!data) {
+        set_error(RGIZMO_ERROR_OUT_OF_MEMORY, "Failed to allocate the trace");
+        return false;
+    }
+    text->data = data;
+    text->capacity = capacity;
+
+    va_start(args, format);
+    vsnprintf(text->data + text->size, capacity - text->size, format, args);
+    va_end(args);
+    text->size += n;
+    return true;
+}
+
+// Complete ("X") events in microseconds, one thread
+bool rgizmo_save_chrome_trace(const char *file_name) {
+    unsigned int n_events = STATS_N_EVENTS < STATS_MAX_EVENTS
+                                ? STATS_N_EVENTS
+                                : STATS_MAX_EVENTS;
+    unsigned int first = STATS_N_EVENTS - n_events;
+    TraceText text = {NULL, 0, 128 * (size_t)n_events + 64};
+    text.data = (char *)malloc(text.capacity);
+    if (!text.data) return false;
+
+    bool is_ok = append_trace_text(&text, "{\"traceEvents\":[\n");
+    for (unsigned int i = 0; i < n_events && is_ok; ++i) {
+        StatsEvent e = STATS_EVENTS[(first + i) % STATS_MAX_EVENTS];
+        is_ok = append_trace_text(
+            &text,
+            "{\"name\":\"%s\",\"cat\":\"raygizmo\",\"ph\":\"X\","
+            "\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":0}%s\n",
+            PHASE_NAMES[e.phase],
+            1e6 * e.start,
+            1e6 * e.duration,
+            i + 1 < n_events ? "," : ""
+        );
+    }
+    if (is_ok) is_ok = append_trace_text(&text, "]}\n");
+
+    bool is_saved = is_ok && SaveFileText(file_name, text.data);
+    free(text.data);
+    return is_saved;
+}
+
+// ---------------------------------------------------------------------------
+// Trace
+static unsigned char *write_trace_u16(unsigned char *bytes, int value) {
+    bytes[0] = (unsigned char)(value & 0xFF);
+    bytes[1] = (unsigned char)((value >> 8) & 0xFF);
+    return bytes + 2;
+}
+
+static unsigned char *write_trace_floats(
+    unsigned char *bytes, const float *values, int count
+) {
+    for (int i = 0; i < count; ++i) {
+        unsigned int bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        for (int k = 0; k < 4; ++k) *bytes++ = (bits >> (8 * k)) & 0xFF;
+    }
+    return bytes;
+}
+
+static int read_trace_u16(const unsigned char **bytes) {
+    int value = (*bytes)[0] | ((*bytes)[1] << 8);
+    *bytes += 2;
+    return value;
+}
+
+static void read_trace_floats(
+    const unsigned char **bytes, float *values, int count
+) {
+    for (int i = 0; i < count; ++i) {
+        unsigned int bits = 0;
+        for (int k = 0; k < 4; ++k) {
+            bits |= (unsigned int)(*bytes)[k] << (8 * k);
+        }
+        memcpy(&values[i], &bits, sizeof(bits));
+        *bytes += 4;
+    }
+}
+
+// "RGZT", version and frame size as u16
+void rgizmo_trace_write_header(unsigned char *bytes) {
+    memcpy(bytes, "RGZT", 4);
+    bytes = write_trace_u16(bytes + 4, RGIZMO_TRACE_VERSION);
+    write_trace_u16(bytes, RGIZMO_TRACE_FRAME_SIZE);
+}
+
+bool rgizmo_trace_read_header(const unsigned char *bytes, int size) {
+    if (size < RGIZMO_TRACE_HEADER_SIZE || memcmp(bytes, "RGZT", 4) != 0) {
+        return false;
+    }
+    bytes += 4;
+    int version = read_trace_u16(&bytes);
+    int frame_size = read_trace_u16(&bytes);
+    return version == RGIZMO_TRACE_VERSION
+           && frame_size == RGIZMO_TRACE_FRAME_SIZE;
+}
+
+// Mouse position and delta (4 f32), screen size (2 u16), flags (u8: left
+// mouse button, orthographic camera), camera position, target and up
+// (9 f32), fovy (f32) and gizmo position (3 f32)
+void rgizmo_trace_write_frame(unsigned char *bytes, RGizmoTraceFrame frame) {
+    float mouse[4] = {
+        frame.input.mouse_position.x,
+        frame.input.mouse_position.y,
+        frame.input.mouse_delta.x,
+        frame.input.mouse_delta.y};
+    bytes = write_trace_floats(bytes, mouse, 4);
+    bytes = write_trace_u16(bytes, frame.input.screen_width);
+    bytes = write_trace_u16(bytes, frame.input.screen_height);
+    *bytes++ = (frame.input.is_lmb_down ? 1 : 0)
+               | (frame.camera.projection == CAMERA_ORTHOGRAPHIC ? 2 : 0);
+    bytes = write_trace_floats(bytes, &frame.camera.position.x, 3);
+    bytes = write_trace_floats(bytes, &frame.camera.target.x, 3);
+    bytes = write_trace_floats(bytes, &frame.camera.up.x, 3);
+    bytes = write_trace_floats(bytes, &frame.camera.fovy, 1);
+    write_trace_floats(bytes, &frame.position.x, 3);
+}
+
+RGizmoTraceFrame rgizmo_trace_read_frame(const unsigned char *bytes) {
+    RGizmoTraceFrame frame;
+    float mouse[4];
+    read_trace_floats(&bytes, mouse, 4);
+    frame.input.mouse_position = (Vector2){mouse[0], mouse[1]};
+    frame.input.mouse_delta = (Vector2){mouse[2], mouse[3]};
+    frame.input.screen_width = read_trace_u16(&bytes);
+    frame.input.screen_height = read_trace_u16(&bytes);
+    unsigned char flags = *bytes++;
+    frame.input.is_lmb_down = flags & 1;
+    frame.camera.projection = flags & 2 ? CAMERA_ORTHOGRAPHIC
+                                        : CAMERA_PERSPECTIVE;
+    read_trace_floats(&bytes, &frame.camera.position.x, 3);
+    read_trace_floats(&bytes, &frame.camera.target.x, 3);
+    read_trace_floats(&bytes, &frame.camera.up.x, 3);
+    read_trace_floats(&bytes, &frame.camera.fovy, 1);
+    read_trace_floats(&bytes, &frame.position.x, 3);
+    return frame;
+}
+
+// ---------------------------------------------------------------------------
+// Delta stream
+
+// A record is a tag byte (the record type, the axis id in the bits 3-4)
+// followed by the begin position and steps (5 f32), or by one (rotation,
+// translation along the axis) or two (translation in the plane normal to
+// the axis) zigzag varints of the quantized delta, or by nothing (end)
+typedef enum DeltaRecord {
+    DELTA_RECORD_NONE,
+    DELTA_RECORD_BEGIN,
+    DELTA_RECORD_END,
+    DELTA_RECORD_ROTATE,
+    DELTA_RECORD_TRANSLATE_AXIS,
+    DELTA_RECORD_TRANSLATE_PLANE,
+} DeltaRecord;
+
+// Larger deltas are written in parts, the rest stays in the error
+#define DELTA_MAX_QUANTUM 0x3FFFFFFF
+
+static unsigned char *write_delta_varint(unsigned char *bytes, int value) {
+    unsigned int bits = ((unsigned int)value << 1)
+                        ^ (unsigned int)(value >> 31);
+    while (bits >= 0x80) {
+        *bytes++ = (unsigned char)(bits | 0x80);
+        bits >>= 7;
+    }
+    *bytes++ = (unsigned char)bits;
+    return bytes;
+}
+
+static bool read_delta_varint(
+    const unsigned char **bytes, const unsigned char *end, int *value
+) {
+    unsigned int bits = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*bytes == end) return false;
+        unsigned char byte = *(*bytes)++;
+        bits |= (unsigned int)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = (int)(bits >> 1) ^ -(int)(bits & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int get_delta_axis_id(Vector3 axis) {
+    if (fabs(axis.x) >= fabs(axis.y) && fabs(axis.x) >= fabs(axis.z)) {
+        return 0;
+    }
+    return fabs(axis.y) >= fabs(axis.z) ? 1 : 2;
+}
+
+static Vector3 get_delta_axis(int axis_id) {
+    Vector3 axes[3] = {X_AXIS, Y_AXIS, Z_AXIS};
+    return axes[axis_id];
+}
+
+// Adds the quantized delta to the drag of the stream, the same way on both
+// ends of it, and fills the decoded delta
+static void apply_delta(
+    RGizmoDeltaStream *stream,
+    int type,
+    int axis_id,
+    const int *quanta,
+    RGizmoDelta *delta
+) {
+    float translation[3] = {0.0f, 0.0f, 0.0f};
+    float angle = 0.0f;
+    if (type == DELTA_RECORD_ROTATE) {
+        angle = quanta[0] * stream->angle_step;
+    } else if (type == DELTA_RECORD_TRANSLATE_AXIS) {
+        translation[axis_id] = quanta[0] * stream->translation_step;
+    } else {
+        translation[(axis_id + 1) % 3] = quanta[0] * stream->translation_step;
+        translation[(axis_id + 2) % 3] = quanta[1] * stream->translation_step;
+    }
+
+    delta->type = type == DELTA_RECORD_ROTATE ? RGIZMO_DELTA_ROTATE
+                                              : RGIZMO_DELTA_TRANSLATE;
+    delta->position = Vector3Add(
+        stream->drag.position, stream->drag.translation
+    );
+    delta->axis = get_delta_axis(axis_id);
+    delta->translation = (Vector3){
+        translation[0], translation[1], translation[2]};
+    delta->angle = angle;
+
+    stream->drag.axis = delta->axis;
+    stream->drag.translation = Vector3Add(
+        stream->drag.translation, delta->translation
+    );
+    stream->drag.angle += angle;
+}
+
+static void begin_delta_drag(RGizmoDeltaStream *stream, Vector3 position) {
+    stream->drag.is_active = true;
+    stream->drag.position = position;
+    stream->drag.translation = Vector3Zero();
+    stream->drag.angle = 0.0f;
+}
+
+static unsigned char *write_delta_begin(
+    RGizmoDeltaStream *stream, Vector3 position, unsigned char *bytes
+) {
+    float values[5] = {
+        position.x,
+        position.y,
+        position.z,
+        stream->translation_step,
+        stream->angle_step};
+    *bytes++ = DELTA_RECORD_BEGIN;
+    bytes = write_trace_floats(bytes, values, 5);
+
+    begin_delta_drag(stream, position);
+    stream->translation_error = Vector3Zero();
+    stream->angle_error = Vector3Zero();
+    return bytes;
+}
+
+static unsigned char *write_delta_end(
+    RGizmoDeltaStream *stream, unsigned char *bytes
+) {
+    if (!stream->drag.is_active) return bytes;
+
+    bytes += rgizmo_delta_flush(stream, bytes);
+    *bytes++ = DELTA_RECORD_END;
+    stream->drag.is_active = false;
+    return bytes;
+}
+
+RGizmoDeltaStream rgizmo_delta_stream_create(void) {
+    RGizmoDeltaStream stream = {0};
+    stream.translation_step = RGIZMO_DELTA_TRANSLATION_STEP;
+    stream.angle_step = RGIZMO_DELTA_ANGLE_STEP;
+    return stream;
+}
+
+int rgizmo_delta_write(
+    RGizmoDeltaStream *stream,
+    RGizmo gizmo,
+    unsigned int changes,
+    unsigned char *bytes
+) {
+    unsigned char *start = bytes;
+
+    // The kind of the delta: the axis drags translate along the axis, the
+    // plane drags in the plane normal to it
+    int type = DELTA_RECORD_NONE;
+    int axis_id = get_delta_axis_id(gizmo.update.axis);
+    float t[3] = {
+        gizmo.update.translation.x,
+        gizmo.update.translation.y,
+        gizmo.update.translation.z};
+    float u = t[(axis_id + 1) % 3];
+    float v = t[(axis_id + 2) % 3];
+    Vector3 value = Vector3Zero();
+    if (gizmo.update.angle != 0.0f) {
+        type = DELTA_RECORD_ROTATE;
+        value.x = gizmo.update.angle;
+    } else if (fabs(t[axis_id]) >= sqrtf(u * u + v * v) && t[axis_id] != 0.0f) {
+        type = DELTA_RECORD_TRANSLATE_AXIS;
+        value.x = t[axis_id];
+    } else if (u != 0.0f || v != 0.0f) {
+        type = DELTA_RECORD_TRANSLATE_PLANE;
+        value = (Vector3){u, v, 0.0f};
+    }
+
+    // A stream started in the middle of a drag begins it with the first
+    // delta, so the receivers always get the pivot and the steps
+    bool is_begin = (changes & RGIZMO_CHANGE_DRAG_BEGIN)
+                    || (type != DELTA_RECORD_NONE && !stream->drag.is_active);
+    if (is_begin) {
+        bytes = write_delta_end(stream, bytes);
+        bytes = write_delta_begin(stream, gizmo.drag.position, bytes);
+    }
+
+    if (type != DELTA_RECORD_NONE) {
+        if (stream->pending.type != type
+            || stream->pending.axis_id != axis_id) {
+            bytes += rgizmo_delta_flush(stream, bytes);
+            stream->pending.type = type;
+            stream->pending.axis_id = axis_id;
+        }
+        stream->pending.value = Vector3Add(stream->pending.value, value);
+    }
+
+    if (changes & RGIZMO_CHANGE_DRAG_END) {
+        bytes = write_delta_end(stream, bytes);
+    }
+
+    return (int)(bytes - start);
+}
+
+int rgizmo_delta_flush(RGizmoDeltaStream *stream, unsigned char *bytes) {
+    int type = stream->pending.type;
+    if (type == DELTA_RECORD_NONE) return 0;
+
+    int axis_id = stream->pending.axis_id;
+    float step = type == DELTA_RECORD_ROTATE ? stream->angle_step
+                                             : stream->translation_step;
+    float values[2] = {stream->pending.value.x, stream->pending.value.y};
+    int n_values = type == DELTA_RECORD_TRANSLATE_PLANE ? 2 : 1;
+
+    // The error of the same kind and axis is carried into the values: the
+    // plane values are along the two world axes normal to the plane one
+    Vector3 *error = type == DELTA_RECORD_ROTATE ? &stream->angle_error
+                                                 : &stream->translation_error;
+    float errors[3] = {error->x, error->y, error->z};
+    int ids[2] = {axis_id, axis_id};
+    if (type == DELTA_RECORD_TRANSLATE_PLANE) {
+        ids[0] = (axis_id + 1) % 3;
+        ids[1] = (axis_id + 2) % 3;
+    }
+
+    unsigned char *start = bytes;
+    *bytes++ = (unsigned char)(type | (axis_id << 3));
+    int quanta[2] = {0, 0};
+    for (int i = 0; i < n_values; ++i) {
+        float value = values[i] + errors[ids[i]];
+        float quantum = Clamp(
+            roundf(value / step), -DELTA_MAX_QUANTUM, DELTA_MAX_QUANTUM
+        );
+        errors[ids[i]] = value - quantum * step;
+        quanta[i] = (int)quantum;
+        bytes = write_delta_varint(bytes, quanta[i]);
+    }
+
+    *error = (Vector3){errors[0], errors[1], errors[2]};
+    stream->pending.type = DELTA_RECORD_NONE;
+    stream->pending.value = Vector3Zero();
+
+    RGizmoDelta delta;
+    apply_delta(stream, type, axis_id, quanta, &delta);
+    return (int)(bytes - start);
+}
+
+int rgizmo_delta_read(
+    RGizmoDeltaStream *stream,
+    const unsigned char *bytes,
+    int size,
+    RGizmoDelta *delta
+) {
+    if (size < 1) return 0;
+
+    const unsigned char *end = bytes + size;
+    const unsigned char *p = bytes;
+    int type = *p & 7;
+    int axis_id = *p >> 3;
+    p += 1;
+    if (axis_id > 2) return 0;
+
+    memset(delta, 0, sizeof(*delta));
+    switch (type) {
+        case DELTA_RECORD_BEGIN: {
+            if (end - p < 20) return 0;
+            float values[5];
+            read_trace_floats(&p, values, 5);
+            if (!(values[3] > 0.0f) || !(values[4] > 0.0f)) return 0;
+
+            stream->translation_step = values[3];
+            stream->angle_step = values[4];
+            begin_delta_drag(
+                stream, (Vector3){values[0], values[1], values[2]}
+            );
+            delta->type = RGIZMO_DELTA_BEGIN;
+            delta->position = stream->drag.position;
+            break;
+        }
+        case DELTA_RECORD_END: {
+            stream->drag.is_active = false;
+            delta->type = RGIZMO_DELTA_END;
+            delta->position = Vector3Add(
+                stream->drag.position, stream->drag.translation
+            );
+            delta->axis = stream->drag.axis;
+            break;
+        }
+        case DELTA_RECORD_ROTATE:
+        case DELTA_RECORD_TRANSLATE_AXIS:
+        case DELTA_RECORD_TRANSLATE_PLANE: {
+            int quanta[2] = {0, 0};
+            int n_values = type == DELTA_RECORD_TRANSLATE_PLANE ? 2 : 1;
+            for (int i = 0; i < n_values; ++i) {
+                if (!read_delta_varint(&p, end, &quanta[i])) return 0;
+            }
+            apply_delta(stream, type, axis_id, quanta, delta);
+            break;
+        }
+        default: return 0;
+    }
+
+    return (int)(p - bytes);
+}
+
+Matrix rgizmo_delta_get_tranform(RGizmoDelta delta) {
+    RGizmo gizmo = {0};
+    gizmo.update.translation = delta.translation;
+    gizmo.update.axis = delta.axis;
+    gizmo.update.angle = delta.angle;
+    return rgizmo_get_tranform(gizmo, delta.position);
+}
+
+Matrix rgizmo_delta_get_drag_transform(const RGizmoDeltaStream *stream) {
+    RGizmo gizmo = {0};
+    gizmo.drag.position = stream->drag.position;
+    gizmo.drag.translation = stream->drag.translation;
+    gizmo.drag.axis = stream->drag.axis;
+    gizmo.drag.angle = stream->drag.angle;
+    return rgizmo_get_drag_transform(gizmo);
 }
 
 #endif  // RAYGIZMO_IMPLEMENTATION
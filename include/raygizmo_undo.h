@@ -0,0 +1,235 @@
+#ifndef RAYGIZMO_UNDO_H
+#define RAYGIZMO_UNDO_H
+
+#include "raygizmo.h"
+
+// Optional undo history of the gizmo drags. A whole drag is one entry: its
+// totals (RGizmo.drag) and the ids of the objects it has moved, no matrices.
+// The entries live in a fixed block of the caller's memory used as a ring,
+// the oldest ones are dropped when it's full. Define
+// RAYGIZMO_UNDO_IMPLEMENTATION in one compilation unit, like
+// RAYGIZMO_IMPLEMENTATION
+
+typedef struct RGizmoUndo {
+    unsigned char *memory;
+    int capacity;
+
+    // Offsets of the entries in the memory, -1 if there are none. The
+    // current one is the newest done entry, the ones after it are undone
+    int oldest;
+    int newest;
+    int current;
+    int n_entries;
+} RGizmoUndo;
+
+// What to apply to the objects of the entry: the update (the inverse one
+// for rgizmo_undo), its transform (multiply the object transforms by it,
+// like by rgizmo_get_tranform) and the ids. The ids point into the
+// history memory and stay valid until the next record
+typedef struct RGizmoUndoStep {
+    Vector3 position;
+    Vector3 translation;
+    Vector3 axis;
+    float angle;
+    Matrix transform;
+    const unsigned int *ids;
+    int n_ids;
+} RGizmoUndoStep;
+
+// The memory must be 4-byte aligned, an entry takes 56 bytes and 4 per id
+RGizmoUndo rgizmo_undo_create(void *memory, int size);
+void rgizmo_undo_clear(RGizmoUndo *undo);
+
+// Records the drag which has ended with this update (the update has
+// returned RGIZMO_CHANGE_DRAG_END) with the ids of the dragged objects.
+// The undone entries are dropped. Returns whether an entry was recorded:
+// not for the other updates, the drags without any transform, and the
+// entries which don't fit into the memory at all (this clears the history,
+// since the older entries can't be undone past it)
+bool rgizmo_undo_record(
+    RGizmoUndo *undo,
+    RGizmo gizmo,
+    unsigned int changes,
+    const unsigned int *ids,
+    int n_ids
+);
+
+// Return false if there is nothing to undo or to redo
+bool rgizmo_undo(RGizmoUndo *undo, RGizmoUndoStep *step);
+bool rgizmo_redo(RGizmoUndo *undo, RGizmoUndoStep *step);
+
+#ifdef RAYGIZMO_UNDO_IMPLEMENTATION
+#include "raygizmo_undo.h"
+#include "raymath.h"
+#include <string.h>
+
+// The header of an entry, its ids follow it. Offsets of the neighbours are
+// -1 at the ends
+typedef struct UndoEntry {
+    int size;
+    int prev;
+    int next;
+    int n_ids;
+    Vector3 position;
+    Vector3 translation;
+    Vector3 axis;
+    float angle;
+} UndoEntry;
+
+static UndoEntry *get_undo_entry(const RGizmoUndo *undo, int offset) {
+    return (UndoEntry *)(undo->memory + offset);
+}
+
+static const unsigned int *get_undo_entry_ids(
+    const RGizmoUndo *undo, int offset
+) {
+    return (const unsigned int *)(undo->memory + offset + sizeof(UndoEntry));
+}
+
+static void drop_oldest_undo_entry(RGizmoUndo *undo) {
+    UndoEntry *entry = get_undo_entry(undo, undo->oldest);
+    if (undo->current == undo->oldest) undo->current = -1;
+    undo->n_entries -= 1;
+    if (undo->n_entries == 0) {
+        rgizmo_undo_clear(undo);
+        return;
+    }
+
+    undo->oldest = entry->next;
+    get_undo_entry(undo, undo->oldest)->prev = -1;
+}
+
+static void get_undo_step(
+    const RGizmoUndo *undo, int offset, bool is_inverse, RGizmoUndoStep *step
+) {
+    const UndoEntry *entry = get_undo_entry(undo, offset);
+    step->position = entry->position;
+    step->translation = entry->translation;
+    step->axis = entry->axis;
+    step->angle = entry->angle;
+
+    // R(x + t - p) + p is undone by R'(y - t - (p - t)) + p - t
+    if (is_inverse) {
+        step->position = Vector3Subtract(entry->position, entry->translation);
+        step->translation = Vector3Negate(entry->translation);
+        step->angle = -entry->angle;
+    }
+
+    RGizmo gizmo = {0};
+    gizmo.update.translation = step->translation;
+    gizmo.update.axis = step->axis;
+    gizmo.update.angle = step->angle;
+    step->transform = rgizmo_get_tranform(gizmo, step->position);
+    step->ids = get_undo_entry_ids(undo, offset);
+    step->n_ids = entry->n_ids;
+}
+
+RGizmoUndo rgizmo_undo_create(void *memory, int size) {
+    RGizmoUndo undo;
+    undo.memory = (unsigned char *)memory;
+    undo.capacity = size;
+    rgizmo_undo_clear(&undo);
+    return undo;
+}
+
+void rgizmo_undo_clear(RGizmoUndo *undo) {
+    undo->oldest = -1;
+    undo->newest = -1;
+    undo->current = -1;
+    undo->n_entries = 0;
+}
+
+bool rgizmo_undo_record(
+    RGizmoUndo *undo,
+    RGizmo gizmo,
+    unsigned int changes,
+    const unsigned int *ids,
+    int n_ids
+) {
+    if (!(changes & RGIZMO_CHANGE_DRAG_END)) return false;
+    if (gizmo.drag.angle == 0.0f
+        && Vector3Equals(gizmo.drag.translation, Vector3Zero())) {
+        return false;
+    }
+
+    // Drop the undone entries
+    if (undo->current == -1) {
+        rgizmo_undo_clear(undo);
+    } else {
+        while (undo->newest != undo->current) {
+            undo->newest = get_undo_entry(undo, undo->newest)->prev;
+            undo->n_entries -= 1;
+        }
+        get_undo_entry(undo, undo->newest)->next = -1;
+    }
+
+    int size = (int)sizeof(UndoEntry) + n_ids * (int)sizeof(unsigned int);
+    if (size > undo->capacity) {
+        rgizmo_undo_clear(undo);
+        return false;
+    }
+
+    // Right after the newest entry, or from the start if it doesn't fit
+    // till the end. The entries in the way are the oldest ones
+    int offset = 0;
+    if (undo->n_entries > 0) {
+        UndoEntry *newest = get_undo_entry(undo, undo->newest);
+        int newest_end = undo->newest + newest->size;
+        offset = newest_end;
+        if (offset + size > undo->capacity) {
+            offset = 0;
+            while (undo->n_entries > 0 && undo->oldest >= newest_end) {
+                drop_oldest_undo_entry(undo);
+            }
+        }
+        while (undo->n_entries > 0 && undo->oldest < offset + size
+               && offset < undo->oldest
+                               + get_undo_entry(undo, undo->oldest)->size) {
+            drop_oldest_undo_entry(undo);
+        }
+    }
+
+    UndoEntry *entry = get_undo_entry(undo, offset);
+    entry->size = size;
+    entry->prev = undo->n_entries > 0 ? undo->newest : -1;
+    entry->next = -1;
+    entry->n_ids = n_ids;
+    entry->position = gizmo.drag.position;
+    entry->translation = gizmo.drag.translation;
+    entry->axis = gizmo.drag.axis;
+    entry->angle = gizmo.drag.angle;
+    memcpy(
+        undo->memory + offset + sizeof(UndoEntry),
+        ids,
+        n_ids * sizeof(unsigned int)
+    );
+
+    if (undo->n_entries > 0) get_undo_entry(undo, undo->newest)->next = offset;
+    else undo->oldest = offset;
+    undo->newest = offset;
+    undo->current = offset;
+    undo->n_entries += 1;
+    return true;
+}
+
+bool rgizmo_undo(RGizmoUndo *undo, RGizmoUndoStep *step) {
+    if (undo->current == -1) return false;
+
+    get_undo_step(undo, undo->current, true, step);
+    undo->current = get_undo_entry(undo, undo->current)->prev;
+    return true;
+}
+
+bool rgizmo_redo(RGizmoUndo *undo, RGizmoUndoStep *step) {
+    if (undo->n_entries == 0 || undo->current == undo->newest) return false;
+
+    int offset = undo->current == -1
+                     ? undo->oldest
+                     : get_undo_entry(undo, undo->current)->next;
+    get_undo_step(undo, offset, false, step);
+    undo->current = offset;
+    return true;
+}
+
+#endif  // RAYGIZMO_UNDO_IMPLEMENTATION
+#endif  // RAYGIZMO_UNDO_H
@@ -0,0 +1,4 @@
+// The implementation unit of the raygizmo library target (the CMake build),
+// for the projects which link it instead of defining RAYGIZMO_IMPLEMENTATION
+#define RAYGIZMO_IMPLEMENTATION
+#include "raygizmo.h"
@@ -0,0 +1,4 @@
+// The implementation unit of the optional undo module of the raygizmo
+// library target
+#define RAYGIZMO_UNDO_IMPLEMENTATION
+#include "raygizmo_undo.h"
@@ -0,0 +1,1204 @@
+#include "raygizmo.h"
+#include "raygizmo_undo.h"
+
+#include "raylib.h"
+#include "raylib_headless.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Unit tests of the public API, linked against the headless raylib, so the
+// GPU picking picks nothing and everything else runs as with a window:
+// ./raygizmo_tests [test_name]
+
+#define SCREEN_WIDTH 800
+#define SCREEN_HEIGHT 450
+
+static int N_FAILED_CHECKS;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            N_FAILED_CHECKS += 1; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(fabsf((a) - (b)) <= (eps))
+
+static Camera3D get_camera(void) {
+    Camera3D camera;
+    memset(&camera, 0, sizeof(camera));
+    camera.fovy = 45.0f;
+    camera.position = (Vector3){5.0f, 5.0f, 5.0f};
+    camera.up = (Vector3){0.0f, 1.0f, 0.0f};
+    camera.projection = CAMERA_PERSPECTIVE;
+    return camera;
+}
+
+static RGizmoInput get_input(Vector2 mouse_position, bool is_lmb_down) {
+    RGizmoInput input = {
+        mouse_position, {0.0f, 0.0f}, is_lmb_down, SCREEN_WIDTH, SCREEN_HEIGHT};
+    return input;
+}
+
+// State and axis the picked handle gives to a hovering gizmo
+static RGizmoSolveOutput solve_hover(
+    unsigned char picked_id, Camera3D camera, RGizmoInput input
+) {
+    RGizmoSolveInput in;
+    memset(&in, 0, sizeof(in));
+    in.state = RGIZMO_STATE_COLD;
+    in.picked_id = picked_id;
+    in.camera = camera;
+    in.input = input;
+
+    RGizmoSolveOutput out;
+    rgizmo_solve(&in, &out);
+    return out;
+}
+
+// Screen point over the axis handle along the axis, found by walking out
+// from the gizmo center with the CPU picking (of a copy of the gizmo)
+static bool find_axis_handle(
+    RGizmo gizmo, Camera3D camera, Vector3 axis, Vector2 *mouse_position
+) {
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    for (float t = 0.05f; t < 4.0f; t += 0.05f) {
+        Vector2 p = GetWorldToScreenEx(
+            Vector3Scale(axis, t), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+        );
+        RGizmoInput input = get_input(p, false);
+        unsigned char id = rgizmo_pick(&gizmo, camera, Vector3Zero(), input);
+        RGizmoSolveOutput out = solve_hover(id, camera, input);
+        if (out.state == RGIZMO_STATE_HOT_AXIS
+            && Vector3Equals(out.axis, axis)) {
+            *mouse_position = p;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// One frame of a drag of the handle under the cursor: hover on the first
+// frame, press on the second, move the mouse by the delta until the last
+// one, which releases. The position follows the updates of the gizmo
+static unsigned int update_drag_frame(
+    RGizmo *gizmo,
+    Camera3D camera,
+    RGizmoInput *input,
+    Vector3 *position,
+    Vector2 delta,
+    int frame,
+    int n_frames
+) {
+    bool is_last = frame == n_frames - 1;
+    input->is_lmb_down = frame > 0 && !is_last;
+    input->mouse_delta = frame > 1 && !is_last ? delta : Vector2Zero();
+    input->mouse_position = Vector2Add(
+        input->mouse_position, input->mouse_delta
+    );
+
+    unsigned int changes = rgizmo_update_ex(gizmo, camera, *position, *input);
+    *position = Vector3Add(*position, gizmo->update.translation);
+    return changes;
+}
+
+// The largest difference between the elements of the matrices
+static float get_matrix_dist(Matrix a, Matrix b) {
+    float fa[16];
+    float fb[16];
+    memcpy(fa, &a, sizeof(fa));
+    memcpy(fb, &b, sizeof(fb));
+    float dist = 0.0f;
+    for (int i = 0; i < 16; ++i) dist = fmaxf(dist, fabsf(fa[i] - fb[i]));
+    return dist;
+}
+
+// -----------------------------------------------------------------------
+// Transforms
+static void test_tranform_idle(void) {
+    RGizmo gizmo = rgizmo_create();
+    Matrix m = rgizmo_get_tranform(gizmo, (Vector3){1.0f, 2.0f, 3.0f});
+    Vector3 p = Vector3Transform((Vector3){4.0f, 5.0f, 6.0f}, m);
+    CHECK(Vector3Equals(p, (Vector3){4.0f, 5.0f, 6.0f}));
+}
+
+static void test_tranform_translation(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.update.translation = (Vector3){1.0f, -2.0f, 0.5f};
+    Matrix m = rgizmo_get_tranform(gizmo, Vector3Zero());
+
+    Vector3 p = Vector3Transform((Vector3){1.0f, 1.0f, 1.0f}, m);
+    CHECK(Vector3Equals(p, (Vector3){2.0f, -1.0f, 1.5f}));
+}
+
+static void test_tranform_rotation(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.update.axis = (Vector3){0.0f, 0.0f, 1.0f};
+    gizmo.update.angle = 0.5f * PI;
+    Vector3 position = {1.0f, 0.0f, 0.0f};
+    Matrix m = rgizmo_get_tranform(gizmo, position);
+
+    // Rotates around the gizmo position, which stays in place
+    Vector3 p = Vector3Transform(position, m);
+    CHECK(Vector3Equals(p, position));
+
+    p = Vector3Transform((Vector3){2.0f, 0.0f, 0.0f}, m);
+    CHECK(Vector3Equals(p, (Vector3){1.0f, 1.0f, 0.0f}));
+}
+
+static void test_apply_transform_batch(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.update.axis = (Vector3){0.0f, 1.0f, 0.0f};
+    gizmo.update.angle = 0.3f;
+    gizmo.update.translation = (Vector3){0.5f, 0.0f, -1.0f};
+    Vector3 position = {1.0f, 0.0f, 1.0f};
+    Matrix update = rgizmo_get_tranform(gizmo, position);
+
+    // Rotated objects, so the rotation rows are updated too
+    Matrix transforms[5];
+    Matrix expected[5];
+    for (int i = 0; i < 5; ++i) {
+        Vector3 axis = Vector3Normalize((Vector3){1.0f, (float)i, -2.0f});
+        transforms[i] = MatrixMultiply(
+            MatrixRotate(axis, 0.4f * i),
+            MatrixTranslate((float)i, 0.5f * i, -1.0f * i)
+        );
+        expected[i] = MatrixMultiply(transforms[i], update);
+    }
+
+    Vector3 pivot = rgizmo_apply_transform_batch(
+        gizmo, position, transforms, 5, RGIZMO_PIVOT_CENTROID
+    );
+
+    Vector3 centroid = Vector3Zero();
+    for (int i = 0; i < 5; ++i) {
+        CHECK(get_matrix_dist(transforms[i], expected[i]) < 1e-4f);
+        Vector3 p = {transforms[i].m12, transforms[i].m13, transforms[i].m14};
+        centroid = Vector3Add(centroid, Vector3Scale(p, 0.2f));
+    }
+    CHECK_NEAR(pivot.x, centroid.x, 1e-4f);
+    CHECK_NEAR(pivot.y, centroid.y, 1e-4f);
+    CHECK_NEAR(pivot.z, centroid.z, 1e-4f);
+}
+
+static void test_apply_transform_batch_soa(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.update.axis = Vector3Normalize((Vector3){1.0f, 2.0f, 0.5f});
+    gizmo.update.angle = -0.7f;
+    gizmo.update.translation = (Vector3){0.25f, -1.0f, 0.5f};
+    Vector3 position = {-1.0f, 2.0f, 0.5f};
+    Matrix update = rgizmo_get_tranform(gizmo, position);
+
+    // Not a multiple of the SIMD width, so the scalar tail runs too
+    enum { N = 13 };
+    float x[N], y[N], z[N], qx[N], qy[N], qz[N], qw[N];
+    Matrix expected[N];
+    for (int i = 0; i < N; ++i) {
+        Vector3 axis = Vector3Normalize((Vector3){(float)i, 1.0f, -1.0f});
+        Quaternion q = QuaternionFromAxisAngle(axis, 0.3f * i);
+        x[i] = (float)i;
+        y[i] = -0.5f * i;
+        z[i] = 2.0f - i;
+        qx[i] = q.x;
+        qy[i] = q.y;
+        qz[i] = q.z;
+        qw[i] = q.w;
+        Matrix transform = MatrixMultiply(
+            QuaternionToMatrix(q), MatrixTranslate(x[i], y[i], z[i])
+        );
+        expected[i] = MatrixMultiply(transform, update);
+    }
+
+    RGizmoTransforms soa = {x, y, z, qx, qy, qz, qw, N};
+    rgizmo_apply_transform_batch_soa(
+        gizmo, position, soa, RGIZMO_PIVOT_CENTROID
+    );
+    for (int i = 0; i < N; ++i) {
+        Quaternion q = {qx[i], qy[i], qz[i], qw[i]};
+        Matrix transform = MatrixMultiply(
+            QuaternionToMatrix(q), MatrixTranslate(x[i], y[i], z[i])
+        );
+        CHECK(get_matrix_dist(transform, expected[i]) < 1e-4f);
+    }
+}
+
+// -----------------------------------------------------------------------
+// Picking
+static void test_pick_cpu_axes(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){1.0f, 0.0f, 0.0f}, &p));
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){0.0f, 1.0f, 0.0f}, &p));
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){0.0f, 0.0f, 1.0f}, &p));
+
+    // Far away from the gizmo
+    RGizmoInput input = get_input((Vector2){5.0f, 5.0f}, false);
+    CHECK(rgizmo_pick(&gizmo, camera, Vector3Zero(), input) == 0);
+}
+
+static void test_pick_draw_list_agrees_with_cpu(void) {
+    static RGizmoDrawVertex vertices[RGIZMO_DRAW_LIST_MAX_VERTICES];
+    static unsigned short indices[RGIZMO_DRAW_LIST_MAX_INDICES];
+    RGizmoDrawList list = {
+        vertices,
+        indices,
+        RGIZMO_DRAW_LIST_MAX_VERTICES,
+        RGIZMO_DRAW_LIST_MAX_INDICES,
+        0,
+        0};
+
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    RGizmoInput input = get_input(Vector2Zero(), false);
+    CHECK(rgizmo_build_draw_list(gizmo, camera, Vector3Zero(), input, &list));
+    CHECK(list.n_indices > 0 && list.n_indices % 3 == 0);
+
+    // Both tessellate the same handles, so only the edge pixels may differ
+    Rectangle bounds = rgizmo_get_screen_bounds(gizmo, camera, Vector3Zero());
+    int n_hits = 0;
+    int n_agreements = 0;
+    for (float y = bounds.y; y < bounds.y + bounds.height; y += 4.0f) {
+        for (float x = bounds.x; x < bounds.x + bounds.width; x += 4.0f) {
+            input.mouse_position = (Vector2){x, y};
+            unsigned char cpu_id = rgizmo_pick(
+                &gizmo, camera, Vector3Zero(), input
+            );
+            unsigned char list_id = rgizmo_pick_draw_list(
+                &list, camera, input
+            );
+            if (cpu_id == 0 && list_id == 0) continue;
+
+            n_hits += 1;
+            n_agreements += cpu_id == list_id;
+        }
+    }
+
+    CHECK(n_hits > 100);
+    CHECK(n_agreements >= 0.9f * n_hits);
+}
+
+static void test_draw_list_overflow(void) {
+    RGizmoDrawVertex vertices[16];
+    unsigned short indices[16];
+    RGizmoDrawList list = {vertices, indices, 16, 16, 0, 0};
+
+    RGizmo gizmo = rgizmo_create();
+    RGizmoInput input = get_input(Vector2Zero(), false);
+    CHECK(!rgizmo_build_draw_list(
+        gizmo, get_camera(), Vector3Zero(), input, &list
+    ));
+    CHECK(list.n_vertices == 0 && list.n_indices == 0);
+}
+
+static void test_pick_gpu_headless(void) {
+    RGizmo gizmo = rgizmo_create();
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+
+    // The headless readback is empty: nothing is picked, nothing fails
+    RGizmoInput input = get_input(center, false);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.picked_id == 0);
+    CHECK(gizmo.state == RGIZMO_STATE_COLD);
+
+    headless_reset_n_draw_calls();
+    rgizmo_draw(gizmo, camera, Vector3Zero());
+    CHECK(headless_get_n_draw_calls() > 0);
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_NONE);
+}
+
+static void test_draw_many_without_instancing(void) {
+    RGizmo gizmos[3] = {rgizmo_create(), rgizmo_create(), rgizmo_create()};
+    Vector3 positions[3] = {
+        {-2.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {2.0f, 0.0f, 0.0f}};
+    Camera3D camera = get_camera();
+
+    // One instanced draw per handle range
+    headless_reset_n_draw_calls();
+    rgizmo_draw_many(gizmos, positions, 3, camera);
+    CHECK(headless_get_n_draw_calls() == 7);
+
+    // OpenGL ES 2.0 draws every gizmo on its own
+    headless_set_gl_version(RL_OPENGL_ES_20);
+    headless_reset_n_draw_calls();
+    rgizmo_draw_many(gizmos, positions, 3, camera);
+    CHECK(headless_get_n_draw_calls() == 7 * 3);
+    headless_set_gl_version(RL_OPENGL_33);
+}
+
+static void test_draw_many_line_widths(void) {
+    RGizmo gizmos[2] = {rgizmo_create(), rgizmo_create()};
+    Vector3 positions[2] = {{-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}};
+    for (int i = 0; i < 2; ++i) {
+        gizmos[i].state = RGIZMO_STATE_ACTIVE_AXIS;
+        gizmos[i].update.axis = (Vector3){1.0f, 0.0f, 0.0f};
+        gizmos[i].view.active_axis_draw_thickness = 2.0f + 4.0f * i;
+    }
+
+    // Every active axis line keeps its own width, and the width of the
+    // caller is set back
+    float widths[4];
+    headless_reset_n_draw_calls();
+    rgizmo_draw_many(gizmos, positions, 2, get_camera());
+    CHECK(headless_get_line_widths(widths, 4) == 2);
+    CHECK(widths[0] == 2.0f && widths[1] == 6.0f);
+    CHECK(rlGetLineWidth() == 1.0f);
+}
+
+static void test_pick_retried_after_viewport_change(void) {
+    RGizmoContext *context = rgizmo_context_create((Rectangle){0});
+    rgizmo_set_context(context);
+    RGizmo gizmo = rgizmo_create();
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    RGizmoInput input = get_input(center, false);
+
+    // The picking fbo fails, the gizmo picks on the CPU (draws nothing)
+    headless_set_framebuffer_failing(true);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_FRAMEBUFFER);
+    headless_set_framebuffer_failing(false);
+    headless_reset_n_draw_calls();
+    rgizmo_invalidate_pick_cache(&gizmo);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(headless_get_n_draw_calls() == 0);
+
+    // A new viewport retries the GPU picking
+    rgizmo_context_set_viewport(context, (Rectangle){0, 0, 400, 300});
+    rgizmo_invalidate_pick_cache(&gizmo);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(headless_get_n_draw_calls() > 0);
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_NONE);
+
+    rgizmo_context_destroy(context);
+}
+
+static void test_pick_context_aspect(void) {
+    // A viewport of the half window width, so its aspect is not the window
+    // one which BeginMode3D takes
+    int width = SCREEN_WIDTH / 2;
+    RGizmoContext *context = rgizmo_context_create(
+        (Rectangle){0.0f, 0.0f, (float)width, (float)SCREEN_HEIGHT}
+    );
+    rgizmo_set_context(context);
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.cursor_frustum = false;
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, width, SCREEN_HEIGHT
+    );
+    RGizmoInput input = get_input(center, false);
+    input.screen_width = width;
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+
+    // The picking pass projects like the viewport does
+    Matrix m = headless_get_uniform_matrix();
+    Vector3 point = {1.0f, 0.5f, 0.0f};
+    float x = m.m0 * point.x + m.m4 * point.y + m.m8 * point.z + m.m12;
+    float y = m.m1 * point.x + m.m5 * point.y + m.m9 * point.z + m.m13;
+    float w = m.m3 * point.x + m.m7 * point.y + m.m11 * point.z + m.m15;
+    Vector2 expected = GetWorldToScreenEx(point, camera, width, SCREEN_HEIGHT);
+    CHECK_NEAR(0.5f * (x / w + 1.0f) * width, expected.x, 1e-2f);
+    CHECK_NEAR(0.5f * (1.0f - y / w) * SCREEN_HEIGHT, expected.y, 1e-2f);
+
+    rgizmo_context_destroy(context);
+}
+
+static void test_pick_cache(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    RGizmoInput input = get_input(center, false);
+
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    unsigned int n_misses = gizmo.picking.cache.n_misses;
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.n_hits == 1);
+    CHECK(gizmo.picking.cache.n_misses == n_misses);
+
+    camera.position.x += 0.1f;
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.n_misses == n_misses + 1);
+
+    rgizmo_invalidate_pick_cache(&gizmo);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.n_misses == n_misses + 2);
+}
+
+#if defined(RAYGIZMO_DIRECT_GL)
+static void test_pick_async_pbos(void) {
+    RGizmoContext *context = rgizmo_context_create((Rectangle){0});
+    rgizmo_set_context(context);
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    int n_fences = headless_get_n_fences();
+
+    // More async gizmos than the initial ring while the GPU is busy, every
+    // one of them queues its readback
+    RGizmo gizmos[6];
+    headless_set_gpu_busy(true);
+    for (int i = 0; i < 6; ++i) {
+        gizmos[i] = rgizmo_create();
+        gizmos[i].picking.mode = RGIZMO_PICK_GPU_ASYNC;
+        RGizmoInput input = get_input(center, false);
+        rgizmo_update_ex(&gizmos[i], camera, Vector3Zero(), input);
+    }
+    CHECK(headless_get_n_fences() == n_fences + 6);
+    headless_set_gpu_busy(false);
+
+    // They are not updated anymore, so their readbacks get stale and are
+    // freed while another gizmo keeps picking
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_GPU_ASYNC;
+    for (int i = 0; i < 64; ++i) {
+        Vector2 p = {center.x + (float)(i % 2), center.y};
+        rgizmo_update_ex(&gizmo, camera, Vector3Zero(), get_input(p, false));
+    }
+    CHECK(headless_get_n_fences() == n_fences + 1);
+
+    rgizmo_context_destroy(context);
+    CHECK(headless_get_n_fences() == n_fences);
+}
+
+static void test_needs_redraw_async(void) {
+    RGizmoContext *context = rgizmo_context_create((Rectangle){0});
+    rgizmo_set_context(context);
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_GPU_ASYNC;
+    RGizmoInput input = get_input(center, false);
+
+    // The readback is in flight, only an update delivers its pick
+    headless_set_gpu_busy(true);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(rgizmo_needs_redraw(&gizmo, camera, Vector3Zero(), input));
+
+    headless_set_gpu_busy(false);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(!rgizmo_needs_redraw(&gizmo, camera, Vector3Zero(), input));
+
+    rgizmo_context_destroy(context);
+}
+
+static void test_pick_restores_viewport(void) {
+    RGizmo gizmo = rgizmo_create();
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+
+    // The caller draws into a part of the window
+    int viewport[4];
+    rlViewport(10, 20, 300, 200);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), get_input(center, false));
+    headless_get_viewport(viewport);
+    CHECK(viewport[0] == 10 && viewport[1] == 20);
+    CHECK(viewport[2] == 300 && viewport[3] == 200);
+    rlViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+static void test_pick_async_cache(void) {
+    RGizmoContext *context = rgizmo_context_create((Rectangle){0});
+    rgizmo_set_context(context);
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_GPU_ASYNC;
+
+    // The ring grows up to 64 buffers, all of them in flight here
+    headless_set_gpu_busy(true);
+    for (int i = 0; i < 64; ++i) {
+        Vector2 p = {center.x + (float)(i % 2), center.y};
+        rgizmo_update_ex(&gizmo, camera, Vector3Zero(), get_input(p, false));
+    }
+
+    // Nothing can be queued, so the pick is not cached
+    RGizmoInput input = get_input(center, false);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(!gizmo.picking.cache.is_valid);
+    unsigned int n_misses = gizmo.picking.cache.n_misses;
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.n_misses == n_misses + 1);
+
+    // Once the readbacks have finished the pick is queued and cached
+    headless_set_gpu_busy(false);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.is_valid);
+    unsigned int n_hits = gizmo.picking.cache.n_hits;
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(gizmo.picking.cache.n_hits == n_hits + 1);
+
+    rgizmo_context_destroy(context);
+}
+#endif
+
+// -----------------------------------------------------------------------
+// Interaction
+static void test_axis_drag(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector3 x_axis = {1.0f, 0.0f, 0.0f};
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, x_axis, &p));
+
+    unsigned int changes = rgizmo_update_ex(
+        &gizmo, camera, Vector3Zero(), get_input(p, false)
+    );
+    CHECK(gizmo.state == RGIZMO_STATE_HOT_AXIS);
+    CHECK(changes & RGIZMO_CHANGE_HOVER);
+
+    changes = rgizmo_update_ex(
+        &gizmo, camera, Vector3Zero(), get_input(p, true)
+    );
+    CHECK(gizmo.state == RGIZMO_STATE_ACTIVE_AXIS);
+    CHECK(changes & RGIZMO_CHANGE_DRAG_BEGIN);
+
+    // Drag along the screen direction of the axis
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    Vector2 delta = Vector2Scale(
+        Vector2Normalize(Vector2Subtract(p, center)), 20.0f
+    );
+    RGizmoInput input = get_input(Vector2Add(p, delta), true);
+    input.mouse_delta = delta;
+    changes = rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(changes & RGIZMO_CHANGE_TRANSFORM);
+    CHECK(gizmo.update.translation.x > 0.0f);
+    CHECK_NEAR(gizmo.update.translation.y, 0.0f, 1e-4f);
+    CHECK_NEAR(gizmo.update.translation.z, 0.0f, 1e-4f);
+    Vector3 translation = gizmo.update.translation;
+
+    input.mouse_delta = Vector2Zero();
+    input.is_lmb_down = false;
+    changes = rgizmo_update_ex(&gizmo, camera, translation, input);
+    CHECK(changes & RGIZMO_CHANGE_DRAG_END);
+    CHECK(gizmo.state < RGIZMO_STATE_ACTIVE);
+
+    Matrix m = rgizmo_get_drag_transform(gizmo);
+    CHECK_NEAR(m.m12, translation.x, 1e-5f);
+    CHECK_NEAR(m.m13, translation.y, 1e-5f);
+    CHECK_NEAR(m.m14, translation.z, 1e-5f);
+}
+
+static void test_update_samples_from_time_zero(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){1.0f, 0.0f, 0.0f}, &p));
+
+    // A clock which starts at zero: the first sample is not a stale one
+    RGizmoPointerSample sample = {p, false, 0.0};
+    unsigned int changes = rgizmo_update_samples(
+        &gizmo,
+        camera,
+        Vector3Zero(),
+        get_input(Vector2Zero(), false),
+        &sample,
+        1
+    );
+    CHECK(changes & RGIZMO_CHANGE_HOVER);
+    CHECK(gizmo.state == RGIZMO_STATE_HOT_AXIS);
+    CHECK(gizmo.has_last_sample);
+}
+
+static void test_update_samples_click_drag(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){1.0f, 0.0f, 0.0f}, &p));
+    Vector2 center = GetWorldToScreenEx(
+        Vector3Zero(), camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    Vector2 delta = Vector2Scale(
+        Vector2Normalize(Vector2Subtract(p, center)), 10.0f
+    );
+
+    // Hover, press, drag along the axis and release, all within one frame
+    RGizmoPointerSample samples[6];
+    for (int i = 0; i < 6; ++i) {
+        int n_steps = i < 2 ? 0 : i - 1;
+        samples[i].position = Vector2Add(p, Vector2Scale(delta, n_steps));
+        samples[i].is_lmb_down = i > 0 && i < 5;
+        samples[i].time = 1.0 + 0.001 * i;
+    }
+    samples[5].position = samples[4].position;
+    unsigned int changes = rgizmo_update_samples(
+        &gizmo,
+        camera,
+        Vector3Zero(),
+        get_input(samples[5].position, false),
+        samples,
+        6
+    );
+    CHECK(changes & RGIZMO_CHANGE_ACTIVE);
+    CHECK(changes & RGIZMO_CHANGE_DRAG_BEGIN);
+    CHECK(changes & RGIZMO_CHANGE_DRAG_END);
+    CHECK(changes & RGIZMO_CHANGE_TRANSFORM);
+    CHECK(gizmo.state < RGIZMO_STATE_ACTIVE);
+    CHECK(!gizmo.drag.is_active);
+    CHECK(gizmo.drag.translation.x > 0.0f);
+    CHECK_NEAR(gizmo.drag.translation.x, gizmo.update.translation.x, 1e-5f);
+    CHECK_NEAR(gizmo.drag.position.x, 0.0f, 1e-5f);
+}
+
+static void test_update_reads_headless_input(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){0.0f, 1.0f, 0.0f}, &p));
+
+    headless_set_mouse(p, Vector2Zero(), true);
+    rgizmo_update(&gizmo, camera, Vector3Zero());
+    CHECK(gizmo.state == RGIZMO_STATE_ACTIVE_AXIS);
+
+    headless_set_mouse(p, Vector2Zero(), false);
+    rgizmo_update(&gizmo, camera, Vector3Zero());
+    CHECK(gizmo.state < RGIZMO_STATE_ACTIVE);
+}
+
+static void test_update_many_limit(void) {
+    int count = RGIZMO_UPDATE_MANY_MAX + 1;
+    RGizmo *gizmos = calloc(count, sizeof(RGizmo));
+    Vector3 *positions = calloc(count, sizeof(Vector3));
+    for (int i = 0; i < count; ++i) {
+        gizmos[i] = rgizmo_create();
+        gizmos[i].picking.mode = RGIZMO_PICK_CPU;
+    }
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmos[0], camera, (Vector3){1.0f, 0.0f, 0.0f}, &p));
+    RGizmoInput input = get_input(p, false);
+
+    // The gizmo index doesn't fit into the picked value, nothing is updated
+    unsigned int changes = rgizmo_update_many_ex(
+        gizmos, positions, count, camera, input
+    );
+    CHECK(changes == RGIZMO_CHANGE_NONE);
+    CHECK(gizmos[0].state == RGIZMO_STATE_COLD);
+
+    // The last index still fits
+    changes = rgizmo_update_many_ex(
+        gizmos, positions, count - 1, camera, input
+    );
+    CHECK(changes & RGIZMO_CHANGE_HOVER);
+
+    free(gizmos);
+    free(positions);
+}
+
+static void test_update_many_first_settings(void) {
+    RGizmo gizmos[2] = {rgizmo_create(), rgizmo_create()};
+    Vector3 positions[2] = {{-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}};
+    gizmos[0].picking.mode = RGIZMO_PICK_GPU;
+    gizmos[1].picking.mode = RGIZMO_PICK_GPU;
+    Camera3D camera = get_camera();
+    Vector2 center = GetWorldToScreenEx(
+        positions[1], camera, SCREEN_WIDTH, SCREEN_HEIGHT
+    );
+    RGizmoInput input = get_input(center, false);
+
+    int n_warnings = headless_get_n_warnings();
+    rgizmo_update_many_ex(gizmos, positions, 2, camera, input);
+    CHECK(headless_get_n_warnings() == n_warnings);
+
+    // The CPU picking of the second gizmo is ignored, the batch is picked on
+    // the GPU (the CPU picking draws nothing)
+    gizmos[1].picking.mode = RGIZMO_PICK_CPU;
+    headless_reset_n_draw_calls();
+    rgizmo_update_many_ex(gizmos, positions, 2, camera, input);
+    CHECK(headless_get_n_warnings() == n_warnings + 1);
+    CHECK(headless_get_n_draw_calls() > 0);
+}
+
+static void test_needs_redraw(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    RGizmoInput input = get_input((Vector2){5.0f, 5.0f}, false);
+
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    rgizmo_update_ex(&gizmo, camera, Vector3Zero(), input);
+    CHECK(!rgizmo_needs_redraw(&gizmo, camera, Vector3Zero(), input));
+
+    camera.position.y += 1.0f;
+    CHECK(rgizmo_needs_redraw(&gizmo, camera, Vector3Zero(), input));
+}
+
+// -----------------------------------------------------------------------
+// Traces and errors
+static void test_trace_roundtrip(void) {
+    unsigned char bytes[RGIZMO_TRACE_HEADER_SIZE + RGIZMO_TRACE_FRAME_SIZE];
+    RGizmoTraceFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.input = get_input((Vector2){12.5f, 300.0f}, true);
+    frame.input.mouse_delta = (Vector2){-1.0f, 2.0f};
+    frame.camera = get_camera();
+    frame.position = (Vector3){1.0f, 2.0f, 3.0f};
+
+    rgizmo_trace_write_header(bytes);
+    rgizmo_trace_write_frame(bytes + RGIZMO_TRACE_HEADER_SIZE, frame);
+    CHECK(rgizmo_trace_read_header(bytes, sizeof(bytes)));
+    CHECK(!rgizmo_trace_read_header(bytes, RGIZMO_TRACE_HEADER_SIZE - 1));
+
+    RGizmoTraceFrame read = rgizmo_trace_read_frame(
+        bytes + RGIZMO_TRACE_HEADER_SIZE
+    );
+    CHECK(Vector2Equals(read.input.mouse_position, frame.input.mouse_position)
+    );
+    CHECK(Vector2Equals(read.input.mouse_delta, frame.input.mouse_delta));
+    CHECK(read.input.is_lmb_down == frame.input.is_lmb_down);
+    CHECK(read.input.screen_width == SCREEN_WIDTH);
+    CHECK(read.input.screen_height == SCREEN_HEIGHT);
+    CHECK(Vector3Equals(read.camera.position, frame.camera.position));
+    CHECK(read.camera.fovy == frame.camera.fovy);
+    CHECK(read.camera.projection == frame.camera.projection);
+    CHECK(Vector3Equals(read.position, frame.position));
+}
+
+// -----------------------------------------------------------------------
+// Delta stream
+
+// Exactly the same values, Vector3Equals has a tolerance
+static bool is_vector3_same(Vector3 a, Vector3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Decodes the wire into the receiver stream, returns the number of records
+static int read_deltas(
+    RGizmoDeltaStream *receiver,
+    const unsigned char *wire,
+    int size,
+    RGizmoDelta *deltas,
+    int max_deltas
+) {
+    int n_deltas = 0;
+    int offset = 0;
+    while (offset < size && n_deltas < max_deltas) {
+        int n = rgizmo_delta_read(
+            receiver, wire + offset, size - offset, &deltas[n_deltas]
+        );
+        if (n == 0) return -1;
+        offset += n;
+        n_deltas += 1;
+    }
+    return n_deltas;
+}
+
+static void test_delta_stream_loopback(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){1.0f, 0.0f, 0.0f}, &p));
+
+    RGizmoDeltaStream sender = rgizmo_delta_stream_create();
+    RGizmoDeltaStream receiver = rgizmo_delta_stream_create();
+    unsigned char wire[64 * RGIZMO_DELTA_MAX_WRITE_SIZE];
+    int size = 0;
+
+    // Hover, press, drag for 12 frames sending every 4th, release
+    Vector3 position = Vector3Zero();
+    RGizmoInput input = get_input(p, false);
+    int n_frames = 15;
+    for (int i = 0; i < n_frames; ++i) {
+        Vector2 delta = {3.0f, 1.0f};
+        unsigned int changes = update_drag_frame(
+            &gizmo, camera, &input, &position, delta, i, n_frames
+        );
+        size += rgizmo_delta_write(&sender, gizmo, changes, wire + size);
+        if (i % 4 == 3) size += rgizmo_delta_flush(&sender, wire + size);
+    }
+
+    RGizmoDelta deltas[64];
+    int n_deltas = read_deltas(&receiver, wire, size, deltas, 64);
+    CHECK(n_deltas >= 3);
+    CHECK(n_deltas <= 3 + 12 / 4);
+    CHECK(deltas[0].type == RGIZMO_DELTA_BEGIN);
+    CHECK(deltas[n_deltas - 1].type == RGIZMO_DELTA_END);
+    CHECK(size < 3 * 64);
+
+    // The receiver has exactly what the sender has sent, which is the drag
+    // up to the quantization step
+    CHECK(!receiver.drag.is_active && !sender.drag.is_active);
+    CHECK(is_vector3_same(receiver.drag.position, sender.drag.position));
+    CHECK(is_vector3_same(receiver.drag.translation, sender.drag.translation));
+    CHECK(is_vector3_same(receiver.drag.axis, sender.drag.axis));
+    CHECK(receiver.drag.angle == sender.drag.angle);
+    CHECK(gizmo.drag.translation.x > 0.0f);
+    CHECK_NEAR(
+        receiver.drag.translation.x,
+        gizmo.drag.translation.x,
+        RGIZMO_DELTA_TRANSLATION_STEP
+    );
+
+    Matrix sent = rgizmo_delta_get_drag_transform(&sender);
+    Matrix received = rgizmo_delta_get_drag_transform(&receiver);
+    CHECK(memcmp(&sent, &received, sizeof(sent)) == 0);
+
+    // The deltas add up to the drag
+    Vector3 q = Vector3Zero();
+    for (int i = 0; i < n_deltas; ++i) {
+        q = Vector3Transform(q, rgizmo_delta_get_tranform(deltas[i]));
+    }
+    CHECK_NEAR(q.x, received.m12, 1e-5f);
+}
+
+static void test_delta_stream_rounding(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.drag.position = (Vector3){1.0f, 2.0f, 3.0f};
+    gizmo.update.axis = (Vector3){0.0f, 1.0f, 0.0f};
+
+    RGizmoDeltaStream sender = rgizmo_delta_stream_create();
+    RGizmoDeltaStream receiver = rgizmo_delta_stream_create();
+    unsigned char wire[RGIZMO_DELTA_MAX_WRITE_SIZE];
+    RGizmoDelta deltas[8];
+
+    // Every rotation is sent alone and rounded, the error doesn't add up
+    float angle = 0.0f;
+    for (int i = 0; i < 100; ++i) {
+        gizmo.update.angle = 0.0123457f;
+        angle += gizmo.update.angle;
+        unsigned int changes = i == 0 ? RGIZMO_CHANGE_DRAG_BEGIN : 0;
+        int size = rgizmo_delta_write(&sender, gizmo, changes, wire);
+        size += rgizmo_delta_flush(&sender, wire + size);
+        CHECK(size <= RGIZMO_DELTA_MAX_WRITE_SIZE);
+        CHECK(read_deltas(&receiver, wire, size, deltas, 8) > 0);
+    }
+    CHECK_NEAR(receiver.drag.angle, angle, RGIZMO_DELTA_ANGLE_STEP);
+    CHECK(Vector3Equals(receiver.drag.position, gizmo.drag.position));
+    CHECK(Vector3Equals(receiver.drag.axis, gizmo.update.axis));
+
+    // A plane translation of the stream started in the middle of a drag,
+    // and a truncated record
+    RGizmoDeltaStream late = rgizmo_delta_stream_create();
+    gizmo.update.angle = 0.0f;
+    gizmo.update.translation = (Vector3){0.25f, 0.0f, -0.5f};
+    int size = rgizmo_delta_write(&late, gizmo, 0, wire);
+    size += rgizmo_delta_flush(&late, wire + size);
+
+    RGizmoDeltaStream late_receiver = rgizmo_delta_stream_create();
+    CHECK(read_deltas(&late_receiver, wire, size - 1, deltas, 8) == -1);
+    late_receiver = rgizmo_delta_stream_create();
+    CHECK(read_deltas(&late_receiver, wire, size, deltas, 8) == 2);
+    CHECK(deltas[0].type == RGIZMO_DELTA_BEGIN);
+    CHECK(deltas[1].type == RGIZMO_DELTA_TRANSLATE);
+    CHECK(Vector3Equals(deltas[1].translation, gizmo.update.translation));
+
+    // The rounding error of one axis is not carried into another one: both
+    // 0.55 steps round up
+    float step = RGIZMO_DELTA_TRANSLATION_STEP;
+    RGizmoDeltaStream axes = rgizmo_delta_stream_create();
+    RGizmoDeltaStream axes_receiver = rgizmo_delta_stream_create();
+    Vector3 axis_translations[2] = {
+        {0.55f * step, 0.0f, 0.0f}, {0.0f, 0.55f * step, 0.0f}};
+    for (int i = 0; i < 2; ++i) {
+        gizmo.update.axis = i == 0 ? (Vector3){1.0f, 0.0f, 0.0f}
+                                   : (Vector3){0.0f, 1.0f, 0.0f};
+        gizmo.update.translation = axis_translations[i];
+        size = rgizmo_delta_write(&axes, gizmo, 0, wire);
+        size += rgizmo_delta_flush(&axes, wire + size);
+        CHECK(read_deltas(&axes_receiver, wire, size, deltas, 8) > 0);
+    }
+    CHECK_NEAR(axes_receiver.drag.translation.x, step, 1e-3f * step);
+    CHECK_NEAR(axes_receiver.drag.translation.y, step, 1e-3f * step);
+}
+
+// -----------------------------------------------------------------------
+// Undo
+
+// Gizmo after a drag which has ended, with the totals of the drag
+static RGizmo get_dragged_gizmo(
+    Vector3 position, Vector3 translation, Vector3 axis, float angle
+) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.drag.position = position;
+    gizmo.drag.translation = translation;
+    gizmo.drag.axis = axis;
+    gizmo.drag.angle = angle;
+    return gizmo;
+}
+
+static void test_undo_redo(void) {
+    unsigned int memory[256];
+    RGizmoUndo undo = rgizmo_undo_create(memory, sizeof(memory));
+    unsigned int ids[3] = {7, 8, 9};
+    RGizmoUndoStep step;
+
+    Vector3 y_axis = {0.0f, 1.0f, 0.0f};
+    RGizmo moved = get_dragged_gizmo(
+        Vector3Zero(), (Vector3){1.0f, 0.0f, -2.0f}, y_axis, 0.0f
+    );
+    RGizmo rotated = get_dragged_gizmo(
+        (Vector3){1.0f, 0.0f, -2.0f}, Vector3Zero(), y_axis, 0.7f
+    );
+
+    // Only the drag ends are recorded
+    CHECK(!rgizmo_undo_record(&undo, moved, RGIZMO_CHANGE_TRANSFORM, ids, 3));
+    CHECK(rgizmo_undo_record(&undo, moved, RGIZMO_CHANGE_DRAG_END, ids, 3));
+    CHECK(rgizmo_undo_record(&undo, rotated, RGIZMO_CHANGE_DRAG_END, ids, 2));
+    CHECK(undo.n_entries == 2);
+
+    Matrix forward = MatrixMultiply(
+        rgizmo_get_drag_transform(moved), rgizmo_get_drag_transform(rotated)
+    );
+    Vector3 p = {2.0f, 1.0f, 0.5f};
+    Vector3 q = Vector3Transform(p, forward);
+
+    CHECK(rgizmo_undo(&undo, &step));
+    CHECK(step.n_ids == 2 && step.ids[0] == 7 && step.ids[1] == 8);
+    CHECK_NEAR(step.angle, -0.7f, 1e-6f);
+    q = Vector3Transform(q, step.transform);
+    CHECK(rgizmo_undo(&undo, &step));
+    CHECK(step.n_ids == 3 && step.ids[2] == 9);
+    q = Vector3Transform(q, step.transform);
+    CHECK(!rgizmo_undo(&undo, &step));
+    CHECK_NEAR(q.x, p.x, 1e-5f);
+    CHECK_NEAR(q.y, p.y, 1e-5f);
+    CHECK_NEAR(q.z, p.z, 1e-5f);
+
+    CHECK(rgizmo_redo(&undo, &step));
+    CHECK(Vector3Equals(step.translation, moved.drag.translation));
+    q = Vector3Transform(q, step.transform);
+    CHECK(rgizmo_redo(&undo, &step));
+    q = Vector3Transform(q, step.transform);
+    CHECK(!rgizmo_redo(&undo, &step));
+    Vector3 expected = Vector3Transform(p, forward);
+    CHECK_NEAR(q.x, expected.x, 1e-5f);
+    CHECK_NEAR(q.y, expected.y, 1e-5f);
+    CHECK_NEAR(q.z, expected.z, 1e-5f);
+
+    // A new drag after an undo drops the undone one
+    CHECK(rgizmo_undo(&undo, &step));
+    CHECK(rgizmo_undo_record(&undo, moved, RGIZMO_CHANGE_DRAG_END, ids, 1));
+    CHECK(undo.n_entries == 2);
+    CHECK(!rgizmo_redo(&undo, &step));
+    CHECK(rgizmo_undo(&undo, &step));
+    CHECK(step.n_ids == 1);
+}
+
+static void test_undo_records_a_drag_once(void) {
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    Camera3D camera = get_camera();
+    Vector2 p;
+    CHECK(find_axis_handle(gizmo, camera, (Vector3){0.0f, 0.0f, 1.0f}, &p));
+
+    unsigned int memory[64];
+    RGizmoUndo undo = rgizmo_undo_create(memory, sizeof(memory));
+    unsigned int id = 1;
+
+    Vector3 position = Vector3Zero();
+    RGizmoInput input = get_input(p, false);
+    int n_frames = 10;
+    for (int i = 0; i < n_frames; ++i) {
+        Vector2 delta = {-2.0f, 2.0f};
+        unsigned int changes = update_drag_frame(
+            &gizmo, camera, &input, &position, delta, i, n_frames
+        );
+        rgizmo_undo_record(&undo, gizmo, changes, &id, 1);
+    }
+    CHECK(undo.n_entries == 1);
+
+    // The undo brings the object back to where the drag has started
+    RGizmoUndoStep step;
+    CHECK(rgizmo_undo(&undo, &step));
+    CHECK(Vector3Length(position) > 0.0f);
+    position = Vector3Transform(position, step.transform);
+    CHECK_NEAR(Vector3Length(position), 0.0f, 1e-5f);
+}
+
+static void test_undo_bounded_memory(void) {
+    unsigned int memory[40];
+    RGizmoUndo undo = rgizmo_undo_create(memory, sizeof(memory));
+    unsigned int ids[16] = {0};
+    RGizmoUndoStep step;
+
+    // The entries of different sizes wrap around many times, the newest
+    // ones are kept
+    int max_n_entries = 0;
+    for (int i = 1; i <= 1000; ++i) {
+        RGizmo gizmo = get_dragged_gizmo(
+            Vector3Zero(),
+            (Vector3){(float)i, 0.0f, 0.0f},
+            (Vector3){1.0f, 0.0f, 0.0f},
+            0.0f
+        );
+        ids[0] = i;
+        CHECK(rgizmo_undo_record(
+            &undo, gizmo, RGIZMO_CHANGE_DRAG_END, ids, 1 + i % 7
+        ));
+        if (undo.n_entries > max_n_entries) max_n_entries = undo.n_entries;
+    }
+    CHECK(max_n_entries >= 2);
+    CHECK(max_n_entries <= (int)sizeof(memory) / 56);
+
+    int n_undone = 0;
+    while (rgizmo_undo(&undo, &step)) {
+        CHECK(step.ids[0] == (unsigned int)(1000 - n_undone));
+        CHECK(step.translation.x == -(float)(1000 - n_undone));
+        n_undone += 1;
+    }
+    CHECK(n_undone == undo.n_entries);
+
+    // An entry bigger than the whole memory clears the history
+    static unsigned int many_ids[64];
+    RGizmo gizmo = get_dragged_gizmo(
+        Vector3Zero(), Vector3One(), Vector3Zero(), 0.0f
+    );
+    CHECK(!rgizmo_undo_record(
+        &undo, gizmo, RGIZMO_CHANGE_DRAG_END, many_ids, 64
+    ));
+    CHECK(undo.n_entries == 0);
+    CHECK(!rgizmo_redo(&undo, &step));
+}
+
+static void test_chrome_trace_long_lines(void) {
+    // The timestamps of a clock which has been running for ages take more
+    // digits than the trace reserves for a line
+    headless_set_time_offset(1e150);
+    rgizmo_reset_stats();
+    RGizmo gizmo = rgizmo_create();
+    gizmo.picking.mode = RGIZMO_PICK_CPU;
+    RGizmoInput input = get_input(Vector2Zero(), false);
+    for (int i = 0; i < 4; ++i) {
+        rgizmo_update_ex(&gizmo, get_camera(), Vector3Zero(), input);
+    }
+    headless_set_time_offset(0.0);
+
+    const char *file_name = "raygizmo_test_trace.json";
+    CHECK(rgizmo_save_chrome_trace(file_name));
+    FILE *file = fopen(file_name, "rb");
+    CHECK(file != NULL);
+    if (!file) return;
+
+    char text[4096];
+    size_t size = fread(text, 1, sizeof(text) - 1, file);
+    text[size] = '\0';
+    fclose(file);
+    remove(file_name);
+    CHECK(size > 4 * 150);
+    CHECK(strncmp(text, "{\"traceEvents\":[", 16) == 0);
+    CHECK(size >= 3 && strcmp(text + size - 3, "]}\n") == 0);
+}
+
+static void test_not_loaded(void) {
+    RGizmo gizmo = rgizmo_create();
+    rgizmo_unload();
+    rgizmo_get_error();
+
+    rgizmo_draw(gizmo, get_camera(), Vector3Zero());
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_NOT_LOADED);
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_NONE);
+
+    RGizmoPointerSample sample = {{400.0f, 300.0f}, true, 1.0};
+    unsigned int changes = rgizmo_update_samples(
+        &gizmo,
+        get_camera(),
+        Vector3Zero(),
+        get_input(sample.position, true),
+        &sample,
+        1
+    );
+    CHECK(changes == RGIZMO_CHANGE_NONE);
+    CHECK(!gizmo.has_last_sample);
+    CHECK(rgizmo_get_error() == RGIZMO_ERROR_NOT_LOADED);
+}
+
+typedef struct Test {
+    const char *name;
+    void (*run)(void);
+} Test;
+
+#define TEST(name) {#name, name}
+
+static const Test TESTS[] = {
+    TEST(test_tranform_idle),
+    TEST(test_tranform_translation),
+    TEST(test_tranform_rotation),
+    TEST(test_apply_transform_batch),
+    TEST(test_apply_transform_batch_soa),
+    TEST(test_pick_cpu_axes),
+    TEST(test_pick_draw_list_agrees_with_cpu),
+    TEST(test_draw_list_overflow),
+    TEST(test_pick_gpu_headless),
+    TEST(test_draw_many_without_instancing),
+    TEST(test_draw_many_line_widths),
+    TEST(test_pick_retried_after_viewport_change),
+    TEST(test_pick_context_aspect),
+    TEST(test_pick_cache),
+#if defined(RAYGIZMO_DIRECT_GL)
+    TEST(test_pick_async_pbos),
+    TEST(test_pick_async_cache),
+    TEST(test_pick_restores_viewport),
+    TEST(test_needs_redraw_async),
+#endif
+    TEST(test_axis_drag),
+    TEST(test_update_samples_from_time_zero),
+    TEST(test_update_samples_click_drag),
+    TEST(test_update_reads_headless_input),
+    TEST(test_update_many_limit),
+    TEST(test_update_many_first_settings),
+    TEST(test_needs_redraw),
+    TEST(test_trace_roundtrip),
+    TEST(test_delta_stream_loopback),
+    TEST(test_delta_stream_rounding),
+    TEST(test_undo_redo),
+    TEST(test_undo_records_a_drag_once),
+    TEST(test_undo_bounded_memory),
+    TEST(test_chrome_trace_long_lines),
+    TEST(test_not_loaded),
+};
+
+int main(int argc, char **argv) {
+    SetTraceLogLevel(LOG_WARNING);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "raygizmo tests");
+
+    int n_tests = sizeof(TESTS) / sizeof(TESTS[0]);
+    int n_failed = 0;
+    for (int i = 0; i < n_tests; ++i) {
+        if (argc > 1 && strcmp(argv[1], TESTS[i].name) != 0) continue;
+
+        int n_failed_checks = N_FAILED_CHECKS;
+        TESTS[i].run();
+        bool is_failed = N_FAILED_CHECKS > n_failed_checks;
+        n_failed += is_failed;
+        printf("%s %s\n", is_failed ? "FAIL" : "ok  ", TESTS[i].name);
+    }
+
+    rgizmo_unload();
+    CloseWindow();
+
+    printf("%d failed\n", n_failed);
+    return n_failed == 0 ? 0 : 1;
+}